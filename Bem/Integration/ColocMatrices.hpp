@@ -0,0 +1,30 @@
+#ifndef COLOCMATRICES_HPP
+#define COLOCMATRICES_HPP
+
+#include "../basic/Bem.hpp"
+
+#include <Eigen/Dense>
+
+namespace Bem {
+
+// ColocMatrices is the common interface of the compressed representations of the
+// colocation matrices G and H (MultipoleTree, HMatrix). They provide the products
+// with both matrices, without the solid angle term on the diagonal of H, which has
+// to be added by the simulation (see ColocSim::assemble_matrices).
+
+class ColocMatrices {
+public:
+    virtual ~ColocMatrices() {}
+
+    virtual Eigen::VectorXd multiply_G(Eigen::VectorXd const& v) const = 0;
+    virtual Eigen::VectorXd multiply_H(Eigen::VectorXd const& v) const = 0;
+
+    // diagonal of G (used for preconditioning)
+    virtual Eigen::VectorXd diagonal_G() const = 0;
+
+    virtual size_t size() const = 0;
+};
+
+} // namespace Bem
+
+#endif // COLOCMATRICES_HPP
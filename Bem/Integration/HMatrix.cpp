@@ -0,0 +1,341 @@
+#include "HMatrix.hpp"
+
+#include <vector>
+#include <algorithm> // for nth_element(), sort(), unique()
+#include <numeric>   // for iota()
+#include <omp.h>
+
+using namespace std;
+
+namespace Bem {
+
+// adaptive cross approximation with partial pivoting. row(i,r) and col(j,c) must return
+// row i resp. column j of the m x n matrix which is approximated. Returns false if the
+// required rank is too large for a low-rank representation to pay off.
+template<typename RowFn,typename ColFn>
+bool aca(size_t m,size_t n,RowFn row,ColFn col,real eps,Eigen::MatrixXd& U,Eigen::MatrixXd& V) {
+    size_t max_rank = min(m,n)/2;
+    vector<Eigen::VectorXd> us, vs;
+    vector<bool> row_used(m,false);
+    real norm2(0.0);
+    bool converged(false);
+
+    size_t i(0);
+    Eigen::VectorXd r(n), c(m);
+    for(size_t it(0);it<m and us.size()<max_rank;++it) {
+        row_used[i] = true;
+        row(i,r);
+        for(size_t k(0);k<us.size();++k)
+            r -= us[k](i)*vs[k];
+
+        Eigen::Index j;
+        real pivot = r.cwiseAbs().maxCoeff(&j);
+        if(pivot > 0.0) {
+            Eigen::VectorXd v = r/r(j);
+            col(j,c);
+            for(size_t k(0);k<us.size();++k)
+                c -= vs[k](j)*us[k];
+
+            // update of the frobenius norm of the approximation
+            for(size_t k(0);k<us.size();++k)
+                norm2 += 2.0*us[k].dot(c)*vs[k].dot(v);
+            norm2 += c.squaredNorm()*v.squaredNorm();
+
+            us.push_back(c);
+            vs.push_back(v);
+
+            if(c.norm()*v.norm() <= eps*sqrt(norm2)) {
+                converged = true;
+                break;
+            }
+        }
+
+        // next row: the largest entry of the last column among the unused rows
+        bool found(false);
+        real max_val(-1.0);
+        for(size_t k(0);k<m;++k) {
+            if(row_used[k]) continue;
+            real val = us.empty() ? 0.0 : abs(us.back()(k));
+            if(val > max_val) {
+                max_val = val;
+                i = k;
+                found = true;
+            }
+        }
+        if(not found) {
+            converged = true;
+            break;
+        }
+    }
+    if(not converged) return false;
+
+    U = Eigen::MatrixXd(m,us.size());
+    V = Eigen::MatrixXd(n,vs.size());
+    for(size_t k(0);k<us.size();++k) {
+        U.col(k) = us[k];
+        V.col(k) = vs[k];
+    }
+    return true;
+}
+
+
+HMatrix::HMatrix(vector<vec3> const& x,vector<Triplet> const& trigs,Integrator const& inter,bool mirror,real eps,real eta,size_t leaf_size)
+    :x(x),trigs(trigs),inter(inter),mirror(mirror),eps(eps),eta(eta) {
+
+    size_t N(x.size());
+    cache = inter.make_triangle_cache(x,trigs);
+    vert_trigs = vector<vector<size_t>>(N);
+    for(size_t j(0);j<trigs.size();++j) {
+        vert_trigs[trigs[j].a].push_back(j);
+        vert_trigs[trigs[j].b].push_back(j);
+        vert_trigs[trigs[j].c].push_back(j);
+    }
+
+    build_clusters(leaf_size);
+    build_blocks(0,0);
+
+    #pragma omp parallel
+    {
+    vector<long> local(N,-1);
+
+    #pragma omp for schedule(dynamic)
+    for(size_t b = 0;b<blocks.size();++b)
+        assemble_block(blocks[b],local);
+    }
+
+    // the diagonal lies in the dense blocks of identical clusters
+    diag_G = Eigen::VectorXd::Zero(N);
+    for(Block const& block : blocks) {
+        if(block.row != block.col) continue;
+        Cluster const& t = clusters[block.row];
+        for(size_t k(t.begin);k<t.end;++k)
+            diag_G(order[k]) = block.G.U(k-t.begin,k-t.begin);
+    }
+}
+
+// builds the cluster tree by bisecting the vertices at the median along the longest
+// side of their bounding box. The children are appended after their parent.
+void HMatrix::build_clusters(size_t leaf_size) {
+    order = vector<size_t>(x.size());
+    iota(order.begin(),order.end(),0);
+
+    clusters.clear();
+    Cluster root;
+    root.begin = 0;
+    root.end = x.size();
+    clusters.push_back(root);
+
+    for(size_t n(0);n<clusters.size();++n) {
+        size_t begin = clusters[n].begin;
+        size_t end = clusters[n].end;
+
+        vec3 lo(x[order[begin]]), hi(lo);
+        for(size_t k(begin);k<end;++k) {
+            vec3 const& p = x[order[k]];
+            lo = vec3(min(lo.x,p.x),min(lo.y,p.y),min(lo.z,p.z));
+            hi = vec3(max(hi.x,p.x),max(hi.y,p.y),max(hi.z,p.z));
+        }
+        clusters[n].lo = lo;
+        clusters[n].hi = hi;
+        clusters[n].child = 0;
+
+        if(end - begin <= leaf_size) continue;
+
+        vec3 ext = hi - lo;
+        size_t axis = 0;
+        if(ext.y > ext.x) axis = 1;
+        if(ext.z > (axis == 0 ? ext.x : ext.y)) axis = 2;
+
+        size_t mid = (begin + end)/2;
+        nth_element(order.begin()+begin,order.begin()+mid,order.begin()+end,[&](size_t i,size_t j){
+            return (axis == 0) ? x[i].x < x[j].x : ((axis == 1) ? x[i].y < x[j].y : x[i].z < x[j].z);
+        });
+
+        clusters[n].child = clusters.size();
+        Cluster first, second;
+        first.begin = begin;
+        first.end = mid;
+        second.begin = mid;
+        second.end = end;
+        clusters.push_back(first);
+        clusters.push_back(second);
+    }
+}
+
+bool HMatrix::admissible(Cluster const& t,Cluster const& s) const {
+    real diam = min((t.hi-t.lo).norm(),(s.hi-s.lo).norm());
+    vec3 gap(max(0.0,max(s.lo.x-t.hi.x,t.lo.x-s.hi.x)),
+             max(0.0,max(s.lo.y-t.hi.y,t.lo.y-s.hi.y)),
+             max(0.0,max(s.lo.z-t.hi.z,t.lo.z-s.hi.z)));
+    real dist = gap.norm();
+    return dist > 0.0 and diam <= eta*dist;
+}
+
+void HMatrix::build_blocks(size_t t,size_t s) {
+    Cluster const& ct = clusters[t];
+    Cluster const& cs = clusters[s];
+    if(admissible(ct,cs) or ct.child == 0 or cs.child == 0) {
+        Block block;
+        block.row = t;
+        block.col = s;
+        block.G.low_rank = admissible(ct,cs);
+        block.H.low_rank = block.G.low_rank;
+        blocks.push_back(block);
+        return;
+    }
+    for(size_t i(0);i<2;++i)
+        for(size_t j(0);j<2;++j)
+            build_blocks(ct.child+i,cs.child+j);
+}
+
+HomoPair<LinElm> HMatrix::element(size_t i,size_t j) const {
+    HomoPair<LinElm> result;
+    inter.integrate_Lin_coloc_elements(x,cache,i,j,result);
+    if(mirror) {
+        // the mirrored mesh contributes the same as the original mesh w.r.t. the mirrored point
+        HomoPair<LinElm> mir;
+        vec3 y = x[i];
+        y.x = -y.x;
+        inter.integrate_Lin_point_elements(cache,y,j,mir);
+        result += mir;
+    }
+    return result;
+}
+
+void HMatrix::sample_row(Block const& block,size_t i,vector<size_t> const& col_trigs,vector<long> const& local,Eigen::VectorXd& G_row,Eigen::VectorXd& H_row) const {
+    size_t n = clusters[block.col].end - clusters[block.col].begin;
+    G_row = Eigen::VectorXd::Zero(n);
+    H_row = Eigen::VectorXd::Zero(n);
+    for(size_t j : col_trigs) {
+        HomoPair<LinElm> e = element(i,j);
+        for(size_t k(0);k<3;++k) {
+            long l = local[trigs[j][k]];
+            if(l < 0) continue;
+            G_row(l) += e.G[k];
+            H_row(l) += e.H[k];
+        }
+    }
+}
+
+void HMatrix::sample_col(Block const& block,size_t j,Eigen::VectorXd& G_col,Eigen::VectorXd& H_col) const {
+    Cluster const& t = clusters[block.row];
+    G_col = Eigen::VectorXd::Zero(t.end-t.begin);
+    H_col = Eigen::VectorXd::Zero(t.end-t.begin);
+    for(size_t tri : vert_trigs[j]) {
+        size_t k = (trigs[tri].a == j) ? 0 : ((trigs[tri].b == j) ? 1 : 2);
+        for(size_t r(t.begin);r<t.end;++r) {
+            HomoPair<LinElm> e = element(order[r],tri);
+            G_col(r-t.begin) += e.G[k];
+            H_col(r-t.begin) += e.H[k];
+        }
+    }
+}
+
+void HMatrix::assemble_block(Block& block,vector<long>& local) const {
+    Cluster const& t = clusters[block.row];
+    Cluster const& s = clusters[block.col];
+    size_t m(t.end-t.begin), n(s.end-s.begin);
+
+    vector<size_t> col_trigs;
+    for(size_t k(s.begin);k<s.end;++k) {
+        local[order[k]] = k-s.begin;
+        col_trigs.insert(col_trigs.end(),vert_trigs[order[k]].begin(),vert_trigs[order[k]].end());
+    }
+    sort(col_trigs.begin(),col_trigs.end());
+    col_trigs.erase(unique(col_trigs.begin(),col_trigs.end()),col_trigs.end());
+
+    // the sampled rows and columns are kept, since the approximations of G and H
+    // often choose the same pivots
+    vector<Eigen::VectorXd> G_rows(m), H_rows(m), G_cols(n), H_cols(n);
+    auto row = [&](size_t i) {
+        if(G_rows[i].size() == 0)
+            sample_row(block,order[t.begin+i],col_trigs,local,G_rows[i],H_rows[i]);
+    };
+    auto col = [&](size_t j) {
+        if(G_cols[j].size() == 0)
+            sample_col(block,order[s.begin+j],G_cols[j],H_cols[j]);
+    };
+
+    bool G_done(false), H_done(false);
+    if(block.G.low_rank) {
+        G_done = aca(m,n,
+            [&](size_t i,Eigen::VectorXd& r){ row(i); r = G_rows[i]; },
+            [&](size_t j,Eigen::VectorXd& c){ col(j); c = G_cols[j]; },
+            eps,block.G.U,block.G.V);
+        H_done = aca(m,n,
+            [&](size_t i,Eigen::VectorXd& r){ row(i); r = H_rows[i]; },
+            [&](size_t j,Eigen::VectorXd& c){ col(j); c = H_cols[j]; },
+            eps,block.H.U,block.H.V);
+        block.G.low_rank = G_done;
+        block.H.low_rank = H_done;
+    }
+
+    if(not (G_done and H_done)) {
+        Eigen::MatrixXd G(m,n), H(m,n);
+        for(size_t i(0);i<m;++i) {
+            row(i);
+            G.row(i) = G_rows[i].transpose();
+            H.row(i) = H_rows[i].transpose();
+        }
+        if(not G_done) {
+            block.G.U = G;
+            block.G.V.resize(0,0);
+        }
+        if(not H_done) {
+            block.H.U = H;
+            block.H.V.resize(0,0);
+        }
+    }
+
+    for(size_t k(s.begin);k<s.end;++k)
+        local[order[k]] = -1;
+}
+
+Eigen::VectorXd HMatrix::multiply(Eigen::VectorXd const& v,bool single_layer) const {
+    assert(size_t(v.size()) == x.size());
+    size_t N(x.size());
+    vector<Eigen::VectorXd> partial(omp_get_max_threads(),Eigen::VectorXd::Zero(N));
+
+    #pragma omp parallel
+    {
+    Eigen::VectorXd& result = partial[omp_get_thread_num()];
+
+    #pragma omp for schedule(static)
+    for(size_t b = 0;b<blocks.size();++b) {
+        Block const& block = blocks[b];
+        Factors const& f = single_layer ? block.G : block.H;
+        Cluster const& t = clusters[block.row];
+        Cluster const& s = clusters[block.col];
+
+        Eigen::VectorXd v_loc(s.end-s.begin);
+        for(size_t k(s.begin);k<s.end;++k)
+            v_loc(k-s.begin) = v(order[k]);
+
+        Eigen::VectorXd r_loc = f.low_rank ? Eigen::VectorXd(f.U*(f.V.transpose()*v_loc)) : Eigen::VectorXd(f.U*v_loc);
+        for(size_t k(t.begin);k<t.end;++k)
+            result(order[k]) += r_loc(k-t.begin);
+    }
+    }
+
+    Eigen::VectorXd result = Eigen::VectorXd::Zero(N);
+    for(Eigen::VectorXd const& p : partial)
+        result += p;
+    return result;
+}
+
+Eigen::VectorXd HMatrix::multiply_G(Eigen::VectorXd const& v) const {
+    return multiply(v,true);
+}
+
+Eigen::VectorXd HMatrix::multiply_H(Eigen::VectorXd const& v) const {
+    return multiply(v,false);
+}
+
+size_t HMatrix::stored_entries() const {
+    size_t result(0);
+    for(Block const& block : blocks)
+        result += block.G.U.size() + block.G.V.size() + block.H.U.size() + block.H.V.size();
+    return result;
+}
+
+} // namespace Bem
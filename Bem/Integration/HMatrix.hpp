@@ -0,0 +1,99 @@
+#ifndef HMATRIX_HPP
+#define HMATRIX_HPP
+
+#include <vector>
+#include "../basic/Bem.hpp"
+#include "Integrator.hpp"
+#include "ResultTypes.hpp"
+#include "ColocMatrices.hpp"
+
+#include <Eigen/Dense>
+
+namespace Bem {
+
+// The HMatrix is a hierarchical matrix representation of the colocation matrices G and H.
+// The vertices of the mesh are sorted into a binary cluster tree (by bisection of the
+// bounding boxes). A block of two clusters t and s is admissible if
+// min(diam(t),diam(s)) <= eta*dist(t,s); such blocks are approximated by low-rank
+// factors U*V^T, computed with the adaptive cross approximation (ACA, partial pivoting)
+// from a few sampled rows and columns, such that only O(N log N) matrix entries have to
+// be integrated and stored. The remaining (near field) blocks are stored densely.
+// As for the MultipoleTree, the solid angle term on the diagonal of H is not included.
+
+class HMatrix : public ColocMatrices {
+public:
+
+    // eps is the relative accuracy of the low-rank approximations, eta the admissibility
+    // parameter and leaf_size the maximum number of vertices in a leaf cluster. If mirror
+    // is true, the image of the mesh w.r.t. the plane x = 0 is taken into account too.
+    HMatrix(std::vector<vec3> const& x,std::vector<Triplet> const& trigs,Integrator const& inter,bool mirror,
+            real eps = 1e-5,real eta = 2.0,size_t leaf_size = 32);
+
+    virtual Eigen::VectorXd multiply_G(Eigen::VectorXd const& v) const override;
+    virtual Eigen::VectorXd multiply_H(Eigen::VectorXd const& v) const override;
+
+    virtual Eigen::VectorXd diagonal_G() const override {
+        return diag_G;
+    }
+
+    virtual size_t size() const override {
+        return x.size();
+    }
+
+    // number of stored matrix entries (of both matrices)
+    size_t stored_entries() const;
+
+private:
+
+    struct Cluster {
+        vec3 lo, hi;        // bounding box
+        size_t begin, end;  // range in order
+        size_t child;       // index of the first of the two children, zero for leaves
+    };
+
+    // a dense block is stored in U, a low-rank block as U*V^T
+    struct Factors {
+        bool low_rank;
+        Eigen::MatrixXd U, V;
+    };
+
+    struct Block {
+        size_t row, col; // clusters
+        Factors G, H;
+    };
+
+    void build_clusters(size_t leaf_size);
+    void build_blocks(size_t t,size_t s);
+    void assemble_block(Block& block,std::vector<long>& local) const;
+
+    bool admissible(Cluster const& t,Cluster const& s) const;
+
+    // integrals of the (mirrored) kernel over triangle j w.r.t. the colocation point i
+    HomoPair<LinElm> element(size_t i,size_t j) const;
+
+    // row i resp. column j of the block (both matrices)
+    // (col_trigs are the triangles adjacent to the column cluster, local maps the global
+    // vertex indices to the columns of the block)
+    void sample_row(Block const& block,size_t i,std::vector<size_t> const& col_trigs,std::vector<long> const& local,Eigen::VectorXd& G_row,Eigen::VectorXd& H_row) const;
+    void sample_col(Block const& block,size_t j,Eigen::VectorXd& G_col,Eigen::VectorXd& H_col) const;
+
+    Eigen::VectorXd multiply(Eigen::VectorXd const& v,bool single_layer) const;
+
+    std::vector<vec3> x;
+    std::vector<Triplet> trigs;
+    Integrator inter;
+    bool mirror;
+    real eps, eta;
+
+    TriangleCache cache;
+    std::vector<std::vector<size_t>> vert_trigs;
+    std::vector<size_t> order;
+    std::vector<Cluster> clusters;
+    std::vector<Block> blocks;
+
+    Eigen::VectorXd diag_G;
+};
+
+} // namespace Bem
+
+#endif // HMATRIX_HPP
@@ -6,6 +6,53 @@ using Eigen::MatrixXd;
 
 namespace Bem {
 
+DuffyTables::DuffyTables(std::vector<quadrature_1d> const& quad) {
+    // galerkin cases, same substitutions as in the nested loops of the original formulation:
+    // A = xi, B = xi*eta1, C = xi*eta1*eta2, D = xi*eta1*eta2*eta3 (shared vertex: C = xi*eta2, D = C*eta3)
+    for(quadrature_1d xi : quad) {
+        for(quadrature_1d eta1 : quad) {
+            for(quadrature_1d eta2 : quad) {
+                for(quadrature_1d eta3 : quad) {
+                    real w = xi.weight*eta1.weight*eta2.weight*eta3.weight*xi.x*xi.x*xi.x;
+
+                    real A = xi.x;
+                    real B = A*eta1.x;
+                    real C = B*eta2.x;
+                    real D = C*eta3.x;
+
+                    real weight = w*eta1.x*eta1.x*eta2.x;
+                    identical.push_back({A,   A-B+C, A-D, A-B,   weight});
+                    identical.push_back({A-D, A-B,   A,   A-B+C, weight});
+                    identical.push_back({A,   B-C+D, A-C, B-C,   weight});
+                    identical.push_back({A-C, B-C,   A,   B-C+D, weight});
+                    identical.push_back({A-D, B-D,   A,   B-C,   weight});
+                    identical.push_back({A,   B-C,   A-D, B-D,   weight});
+
+                    weight = w*eta1.x*eta1.x;
+                    shared_edge.push_back({A,   B,   A-D, C-D, weight*eta2.x});
+                    shared_edge.push_back({A-C, B-C, A,   D,   weight*eta2.x});
+                    shared_edge.push_back({A-D, C-D, A,   B,   weight*eta2.x});
+                    shared_edge.push_back({A-D, B-D, A,   C,   weight*eta2.x});
+                    shared_edge.push_back({A,   B*eta3.x, A-C, B-C, weight}); // special case here
+
+                    C = A*eta2.x; // different to the other cases!
+                    D = C*eta3.x;
+                    weight = w*eta2.x;
+                    shared_vertex.push_back({A, B, C, D, weight});
+                    shared_vertex.push_back({C, D, A, B, weight});
+                }
+            }
+        }
+    }
+
+    // colocation case: polar coordinates with the angle in (0,pi/4)
+    for(quadrature_1d p : quad) {
+        real angle = p.x*M_PI_4;
+        real c = cos(angle);
+        coloc.push_back({c, sin(angle), p.weight/(c*c)});
+    }
+}
+
 // only one specialization here -> this desingularisation is a bit less general b.c. of some analytical results.
 // Note further that the identical H factor isn't added here, since it is here a property that is related to the
 // local geometry of the mesh and is better added further down.
@@ -22,18 +69,14 @@ void Integrator::integrate_identical_coloc<LinElm>(Interpolator tri_y,LinElm& re
 
     // using an adapted rule here since interpolate interpolates not the same unit triangle than in Ning's Work
     
-    for(quadrature_1d p : quad_1d){
-        p.x *= M_PI_4; // pi/4
-        real cosx = cos(p.x);
-        real sinx = sin(p.x);
-        real dist = (tri_y.interp_relative(cosx,sinx)).norm(); // note: x = a
+    for(PolarPoint const& p : duffy->coloc){
+        real dist = (tri_y.interp_relative(p.c,p.s)).norm(); // note: x = a
         real overall_factor = jac_factor*p.weight/dist;
-        real factor(1.0/(cosx*cosx));
 
         // could provide here a function like get_linear_elements()
-        temp[0] += overall_factor*cosx*factor;        // a
-        temp[1] += overall_factor*(cosx-sinx)*factor; // b
-        temp[2] += overall_factor*sinx*factor;        // c
+        temp[0] += overall_factor*p.c;        // a
+        temp[1] += overall_factor*(p.c-p.s);  // b
+        temp[2] += overall_factor*p.s;        // c
     }
 
     result = temp;
@@ -53,18 +96,14 @@ void Integrator::integrate_identical_coloc_mir(Interpolator tri_y,HomoPair<LinEl
 
     // using an adapted rule here since interpolate interpolates not the same unit triangle than in Ning's Work
     
-    for(quadrature_1d p : quad_1d){
-        p.x *= M_PI_4; // pi/4
-        real cosx = cos(p.x);
-        real sinx = sin(p.x);
-        real dist = (tri_y.interp_relative(cosx,sinx)).norm(); // note: x = a
+    for(PolarPoint const& p : duffy->coloc){
+        real dist = (tri_y.interp_relative(p.c,p.s)).norm(); // note: x = a
         real overall_factor = jac_factor*p.weight/dist;
-        real factor(1.0/(cosx*cosx));
 
         // could provide here a function like get_linear_elements()
-        temp[0] += overall_factor*cosx*factor;        // a
-        temp[1] += overall_factor*(cosx-sinx)*factor; // b
-        temp[2] += overall_factor*sinx*factor;        // c
+        temp[0] += overall_factor*p.c;        // a
+        temp[1] += overall_factor*(p.c-p.s);  // b
+        temp[2] += overall_factor*p.s;        // c
     }
 
     vec3 a = tri_y.interpolate(0.0,0.0);
@@ -283,8 +322,268 @@ void Integrator::integrate_Lin_coloc_local_mir(std::vector<vec3> const& x,size_t
 }
 
 
+PointsSoA::PointsSoA(std::vector<vec3> const& points)
+    :x(points.size()),y(points.size()),z(points.size()) {
+    for(size_t i(0);i<points.size();++i) {
+        x[i] = points[i].x;
+        y[i] = points[i].y;
+        z[i] = points[i].z;
+    }
+}
+
+// kernel of integrate_Lin_coloc_batch for one quadrature point y (with the weights w of the
+// three basis functions). The mirrored mesh contributes the same as the original one w.r.t.
+// the mirrored colocation point (-x,y,z).
+template<bool mirror>
+static inline void coloc_batch_kernel(size_t N,real const* px,real const* py,real const* pz,vec3 y,vec3 n,LinElm const& w,
+                                      real* G0,real* G1,real* G2,real* H0,real* H1,real* H2) {
+    const real yx(y.x), yy(y.y), yz(y.z);
+    const real nx(n.x), ny(n.y), nz(n.z);
+    const real w0(w[0]), w1(w[1]), w2(w[2]);
+
+    #pragma omp simd
+    for(size_t i = 0;i<N;++i) {
+        real dx = yx - px[i];
+        real dy = yy - py[i];
+        real dz = yz - pz[i];
+        real inv = 1.0/sqrt(dx*dx + dy*dy + dz*dz);
+        real g = inv;
+        real h = -(dx*nx + dy*ny + dz*nz)*inv*inv*inv;
+        if(mirror) {
+            dx = yx + px[i];
+            inv = 1.0/sqrt(dx*dx + dy*dy + dz*dz);
+            g += inv;
+            h -= (dx*nx + dy*ny + dz*nz)*inv*inv*inv;
+        }
+        G0[i] += w0*g;
+        G1[i] += w1*g;
+        G2[i] += w2*g;
+        H0[i] += w0*h;
+        H1[i] += w1*h;
+        H2[i] += w2*h;
+    }
+}
+
+// the same for the colocation points index[0],...,index[N-1]
+template<bool mirror>
+static inline void coloc_batch_kernel_indexed(size_t N,size_t const* index,real const* px,real const* py,real const* pz,vec3 y,vec3 n,LinElm const& w,
+                                              real* G0,real* G1,real* G2,real* H0,real* H1,real* H2) {
+    const real yx(y.x), yy(y.y), yz(y.z);
+    const real nx(n.x), ny(n.y), nz(n.z);
+    const real w0(w[0]), w1(w[1]), w2(w[2]);
+
+    #pragma omp simd
+    for(size_t k = 0;k<N;++k) {
+        size_t i(index[k]);
+        real dx = yx - px[i];
+        real dy = yy - py[i];
+        real dz = yz - pz[i];
+        real inv = 1.0/sqrt(dx*dx + dy*dy + dz*dz);
+        real g = inv;
+        real h = -(dx*nx + dy*ny + dz*nz)*inv*inv*inv;
+        if(mirror) {
+            dx = yx + px[i];
+            inv = 1.0/sqrt(dx*dx + dy*dy + dz*dz);
+            g += inv;
+            h -= (dx*nx + dy*ny + dz*nz)*inv*inv*inv;
+        }
+        G0[i] += w0*g;
+        G1[i] += w1*g;
+        G2[i] += w2*g;
+        H0[i] += w0*h;
+        H1[i] += w1*h;
+        H2[i] += w2*h;
+    }
+}
+
+void Integrator::set_quadrature(real tolerance) {
+    quad_tolerance = tolerance;
+    quad_ratio2.clear();
+    if(tolerance <= 0.0) return;
+
+    for(size_t p : triangle_quadrature_precisions) {
+        real ratio = pow(tolerance,1.0/(p+1.0));
+        quad_ratio2.push_back(ratio*ratio);
+    }
+}
+
+size_t Integrator::quadrature_level(real h2,real d2) const {
+    if(quad_tolerance <= 0.0) return 0;
+    for(size_t k(0);k+1<quad_ratio2.size();++k) {
+        if(h2 <= quad_ratio2[k]*d2) return k;
+    }
+    return quad_ratio2.size()-1;
+}
+
+size_t Integrator::select_quadrature(vec3 x,Interpolator const& tri_y) const {
+    if(quad_tolerance <= 0.0) return rule_2d;
+
+    real h2 = std::max(tri_y.interp_relative(1.0,0.0).norm2(),
+              std::max(tri_y.interp_relative(0.0,1.0).norm2(),tri_y.interp_relative(1.0,1.0).norm2()));
+    real d2 = (x - tri_y.interpolate(2.0/3.0,1.0/3.0)).norm2(); // center of the triangle
+    return quadrature_level(h2,d2); // the levels are the indices in triangle_quadratures
+}
+
+TriangleCache Integrator::make_triangle_cache(std::vector<vec3> const& x,std::vector<Triplet> const& trigs) const {
+    // with adaptive quadrature, the points of all rules are stored
+    std::vector<QuadratureList_2d const *> levels;
+    if(quad_tolerance > 0.0) levels = triangle_quadratures;
+    else                     levels.push_back(&quad_2d);
+
+    TriangleCache cache;
+    size_t M(trigs.size());
+    cache.trigs = trigs;
+    cache.level_begin.push_back(0);
+    for(QuadratureList_2d const* quad : levels)
+        cache.level_begin.push_back(cache.level_begin.back() + quad->size());
+    cache.num_quad = cache.level_begin.back();
+    cache.pos = std::vector<vec3>(M*cache.num_quad);
+    cache.weights = std::vector<LinElm>(M*cache.num_quad);
+    cache.normals = std::vector<vec3>(M);
+    cache.centers = std::vector<vec3>(M);
+    cache.size2 = std::vector<real>(M);
+
+    for(size_t j(0);j<M;++j) {
+        Interpolator tri_y(x[trigs[j].a],x[trigs[j].b],x[trigs[j].c]);
+        cache.normals[j] = tri_y.normal();
+        cache.centers[j] = tri_y.interpolate(2.0/3.0,1.0/3.0);
+        cache.size2[j] = std::max(tri_y.interp_relative(1.0,0.0).norm2(),
+                         std::max(tri_y.interp_relative(0.0,1.0).norm2(),tri_y.interp_relative(1.0,1.0).norm2()));
+
+        size_t l(j*cache.num_quad);
+        for(QuadratureList_2d const* quad : levels) {
+            for(quadrature_2d const& q : *quad) {
+                // same transformation to the other unit triangle as in integrate_disjoint_coloc
+                cache.pos[l] = tri_y.interpolate(q.x+q.y,q.y);
+                LinElm w(get_linear_elements(q.x+q.y,q.y));
+                w *= q.weight*tri_y.area();
+                cache.weights[l] = w;
+                ++l;
+            }
+        }
+    }
+    return cache;
+}
+
+// upper bound of the number of levels of the adaptive quadrature (see triangle_quadratures)
+static const size_t max_quadrature_levels = 16;
+
+void Integrator::integrate_Lin_coloc_batch(std::vector<vec3> const& x,PointsSoA const& points,TriangleCache const& cache,size_t begin,size_t end,size_t j,bool mirror,Eigen::MatrixXd& G,Eigen::MatrixXd& H,std::vector<size_t>& scratch) const {
+    assert(size_t(G.rows()) >= points.x.size() and G.cols() == 3);
+    assert(size_t(H.rows()) >= points.x.size() and H.cols() == 3);
+    assert(begin <= end and end <= points.x.size());
+    Triplet tri_j(cache.trigs[j]);
+
+    // the rows of the vertices of tri_j are singular and are overwritten below
+    Eigen::Matrix3d G_rows, H_rows;
+    for(size_t k(0);k<3;++k) {
+        G_rows.row(k) = G.row(tri_j[k]);
+        H_rows.row(k) = H.row(tri_j[k]);
+    }
+
+    size_t num_levels(cache.level_begin.size()-1);
+    if(num_levels == 1) {
+        for(size_t l(0);l<cache.num_quad;++l) {
+            vec3 const& y(cache.pos[j*cache.num_quad + l]);
+            LinElm const& w(cache.weights[j*cache.num_quad + l]);
+            if(mirror)
+                coloc_batch_kernel<true> (end-begin,&points.x[begin],&points.y[begin],&points.z[begin],y,cache.normals[j],w,
+                                          &G(begin,0),&G(begin,1),&G(begin,2),&H(begin,0),&H(begin,1),&H(begin,2));
+            else
+                coloc_batch_kernel<false>(end-begin,&points.x[begin],&points.y[begin],&points.z[begin],y,cache.normals[j],w,
+                                          &G(begin,0),&G(begin,1),&G(begin,2),&H(begin,0),&H(begin,1),&H(begin,2));
+        }
+    } else {
+        // adaptive quadrature: the colocation points are sorted by the level of their rule (counting sort),
+        // then the kernel is evaluated for the points of each level with its quadrature points. The levels
+        // and the sorted indices are kept in scratch, which is only allocated for the first blocks.
+        assert(num_levels <= max_quadrature_levels);
+        size_t n(end-begin);
+        if(scratch.size() < 2*n) scratch.resize(2*n);
+        size_t* level(scratch.data());
+        size_t* index(scratch.data() + n);
+        size_t offset[max_quadrature_levels+1] = {};
+        size_t pos[max_quadrature_levels];
+        vec3 const& c(cache.centers[j]);
+        for(size_t i(begin);i<end;++i) {
+            vec3 d(points.x[i]-c.x,points.y[i]-c.y,points.z[i]-c.z);
+            level[i-begin] = quadrature_level(cache.size2[j],d.norm2());
+            offset[level[i-begin]+1]++;
+        }
+        for(size_t k(0);k<num_levels;++k)
+            offset[k+1] += offset[k];
+        for(size_t k(0);k<num_levels;++k)
+            pos[k] = offset[k];
+        for(size_t i(begin);i<end;++i)
+            index[pos[level[i-begin]]++] = i;
+
+        for(size_t k(0);k<num_levels;++k) {
+            if(offset[k] == offset[k+1]) continue;
+            for(size_t l(cache.level_begin[k]);l<cache.level_begin[k+1];++l) {
+                vec3 const& y(cache.pos[j*cache.num_quad + l]);
+                LinElm const& w(cache.weights[j*cache.num_quad + l]);
+                if(mirror)
+                    coloc_batch_kernel_indexed<true> (offset[k+1]-offset[k],&index[offset[k]],points.x.data(),points.y.data(),points.z.data(),y,cache.normals[j],w,
+                                                      G.col(0).data(),G.col(1).data(),G.col(2).data(),H.col(0).data(),H.col(1).data(),H.col(2).data());
+                else
+                    coloc_batch_kernel_indexed<false>(offset[k+1]-offset[k],&index[offset[k]],points.x.data(),points.y.data(),points.z.data(),y,cache.normals[j],w,
+                                                      G.col(0).data(),G.col(1).data(),G.col(2).data(),H.col(0).data(),H.col(1).data(),H.col(2).data());
+            }
+        }
+    }
+
+    for(size_t k(0);k<3;++k) {
+        if(tri_j[k] < begin or tri_j[k] >= end) continue;
+        G.row(tri_j[k]) = G_rows.row(k);
+        H.row(tri_j[k]) = H_rows.row(k);
+        if(mirror) integrate_Lin_coloc_local_mir(x,tri_j[k],tri_j,G,H);
+        else       integrate_Lin_coloc_local(x,tri_j[k],tri_j,G,H);
+    }
+}
+
+void Integrator::integrate_Lin_coloc_elements(std::vector<vec3> const& x,TriangleCache const& cache,size_t i,size_t j,HomoPair<LinElm>& result) const {
+    Triplet tri_j(cache.trigs[j]);
+
+    if(i == tri_j.a or i == tri_j.b or i == tri_j.c) {  
+        size_t shift = 0;
+        if(i == tri_j.b) shift = 1;
+        if(i == tri_j.c) shift = 2;
+        tri_j.cyclic_reorder(i);
+        Interpolator tri_y(x[tri_j.a],x[tri_j.b],x[tri_j.c]);
+        LinElm temp;
+        integrate_identical_coloc(tri_y,temp); // only G is computed here!
+
+        // undo the cyclic reordering
+        for(size_t k(0);k<3;++k)
+            result.G[(k+shift)%3] = temp[k];
+        result.H = 0.0;
+    } else {
+        integrate_Lin_point_elements(cache,x[i],j,result);
+    }
+}
+
+void Integrator::integrate_Lin_point_elements(TriangleCache const& cache,vec3 y,size_t j,HomoPair<LinElm>& result) const {
+    result.G = 0.0;
+    result.H = 0.0;
+    vec3 const& n(cache.normals[j]);
+    size_t k(0);
+    if(cache.level_begin.size() > 2)
+        k = quadrature_level(cache.size2[j],(y - cache.centers[j]).norm2());
+    for(size_t l(cache.level_begin[k]);l<cache.level_begin[k+1];++l) {
+        vec3 z(cache.pos[j*cache.num_quad + l] - y);
+        LinElm const& w(cache.weights[j*cache.num_quad + l]);
+        real inv = 1.0/z.norm();
+        real g = inv;
+        real h = -z.dot(n)*inv*inv*inv;
+        for(size_t k(0);k<3;++k) {
+            result.G[k] += w[k]*g;
+            result.H[k] += w[k]*h;
+        }
+    }
+}
+
 // Function for computing the potential outside of the mesh surface. x must not be part of the surface!
-real Integrator::get_exterior_potential(std::vector<vec3> const& x, Triplet tri_j, std::vector<real> phi, std::vector<real> psi, vec3 y) const {
+real Integrator::get_exterior_potential(std::vector<vec3> const& x, Triplet tri_j, std::vector<real> const& phi, std::vector<real> const& psi, vec3 y) const {
     HomoPair<LinElm> result;
 
     Interpolator tri_y(x[tri_j.a],x[tri_j.b],x[tri_j.c]);
@@ -3,6 +3,7 @@
 #define INTEGRATOR_HPP
 
 #include <vector>
+#include <memory>
 #include "../basic/Bem.hpp"
 #include "Interpolator.hpp"
 #include "Cubic.hpp"
@@ -25,12 +26,63 @@ template<typename result_t> inline result_t integrand_coloc(vec3 x,real y0,real
 template<typename result_t> inline result_t integrand_coloc_mir(vec3 x,real y0,real y1,Interpolator interp_y);
 template<typename result_t> inline result_t integrand_coloc(vec3 x,real y0,real y1,Cubic const& interp_y);
 
+// positions of the colocation points as structure of arrays, for the batched colocation kernel
+struct PointsSoA {
+    std::vector<real> x,y,z;
+
+    PointsSoA() {}
+    PointsSoA(std::vector<vec3> const& points);
+};
+
+// The TriangleCache holds for every triangle of a mesh the positions of the quadrature points (of the
+// Integrator which created it), the quadrature weights multiplied by the jacobian and the three linear basis
+// functions, and the normal. None of these depend on the colocation point, so the cache is built once per
+// mesh (see Integrator::make_triangle_cache) and shared read-only by all threads.
+// If the Integrator uses distance-adaptive quadrature, the points of all rules are stored for each triangle,
+// the rule of level k occupying the points level_begin[k],...,level_begin[k+1]-1.
+struct TriangleCache {
+    std::vector<Triplet> trigs;
+    size_t num_quad;                 // total number of quadrature points per triangle
+    std::vector<size_t> level_begin; // number of levels + 1 entries
+    std::vector<vec3> pos;           // quadrature point l of triangle j at j*num_quad + l
+    std::vector<LinElm> weights;     // same indexing as pos
+    std::vector<vec3> normals;
+    std::vector<vec3> centers;
+    std::vector<real> size2;         // squared length of the longest edge
+};
+
+// point of a tabulated Duffy transform: the arguments (x0,x1,y0,y1) of the integrand and the weight,
+// including the jacobian of the transform
+struct DuffyPoint {
+    real x0, x1, y0, y1, weight;
+};
+
+// point of the polar rule for the singular colocation integral (see integrate_identical_coloc):
+// cosine and sine of the angle, weight divided by cos^2
+struct PolarPoint {
+    real c, s, weight;
+};
+
+// The DuffyTables hold the quadrature points of the singular integrals after the Duffy transforms,
+// flattened from the nested loops over quad_1d: the four-dimensional galerkin cases identical triangles,
+// shared edge and shared vertex, and the colocation case. None of them depend on the geometry, so they are
+// built once in Integrator::set_quadrature.
+struct DuffyTables {
+    std::vector<DuffyPoint> identical, shared_edge, shared_vertex;
+    std::vector<PolarPoint> coloc;
+
+    DuffyTables(std::vector<quadrature_1d> const& quad);
+};
+
 class Integrator {
 public:
 
     Integrator()
         :quad_2d(quadrature_3)
-        ,quad_1d(gauss_3) {}
+        ,quad_1d(gauss_3)
+        ,rule_2d(find_quadrature(quad_2d))
+        ,duffy(std::make_shared<const DuffyTables>(quad_1d))
+        ,quad_tolerance(0.0) {}
 
     // the functions for integrating the kernel function together with the basis functions over the triangle(s)
     // indicated by tri_i (and tri_j). x is a vector containing the positions of the vertices, G and H are the 
@@ -47,8 +99,27 @@ public:
     void integrate_Lin_coloc_local_cubic(std::vector<vec3> const& x,std::vector<vec3> const& n,size_t i,Triplet tri_j,Eigen::MatrixXd& G,Eigen::MatrixXd& H) const;
     void integrate_Lin_coloc_local      (std::vector<vec3> const& x,size_t i,Triplet tri_j,Eigen::MatrixXd& G,Eigen::MatrixXd& H) const;
     void integrate_Lin_coloc_local_mir  (std::vector<vec3> const& x,size_t i,Triplet tri_j,Eigen::MatrixXd& G,Eigen::MatrixXd& H) const;
+
+    // the geometric data of the triangles for the functions below
+    TriangleCache make_triangle_cache(std::vector<vec3> const& x,std::vector<Triplet> const& trigs) const;
+
+    // batched version of integrate_Lin_coloc_local(_mir) for the colocation points begin,...,end-1 and the
+    // triangle j of the cache at once: points must hold the positions x (as structure of arrays), G and H are
+    // local matrices with (at least) x.size() rows and three columns. The kernel is evaluated for all points of a
+    // quadrature point in a vectorized loop; the rows of the vertices of triangle j (singular integrals) are
+    // computed with the scalar functions above. scratch is a buffer of the calling thread for the sorting
+    // of the points by quadrature level (adaptive quadrature), it grows to 2*(end-begin) entries.
+    void integrate_Lin_coloc_batch      (std::vector<vec3> const& x,PointsSoA const& points,TriangleCache const& cache,size_t begin,size_t end,size_t j,bool mirror,Eigen::MatrixXd& G,Eigen::MatrixXd& H,std::vector<size_t>& scratch) const;
+
+    // the following two functions do not add the values to a matrix but return the three integrals of the
+    // basis functions of triangle j of the cache (in the order a,b,c of the triangle). The first one integrates
+    // with respect to the colocation point x[i] (which may be a vertex of the triangle), the second one with
+    // respect to an arbitrary point y which must not lie on the triangle. They are used for the near field of
+    // the MultipoleTree and the entries of the HMatrix.
+    void integrate_Lin_coloc_elements   (std::vector<vec3> const& x,TriangleCache const& cache,size_t i,size_t j,HomoPair<LinElm>& result) const;
+    void integrate_Lin_point_elements   (TriangleCache const& cache,vec3 y,size_t j,HomoPair<LinElm>& result) const;
     
-    real get_exterior_potential(std::vector<vec3> const& x, Triplet tri_j, std::vector<real> phi, std::vector<real> psi, vec3 y) const;
+    real get_exterior_potential(std::vector<vec3> const& x, Triplet tri_j, std::vector<real> const& phi, std::vector<real> const& psi, vec3 y) const;
 
     // for the following templates, the passed function must be analytic everywhere - 
     // no treatment of singularities is applied.
@@ -61,12 +132,23 @@ public:
     template<typename result_t> 
     void integrate_function(Interpolator tri, result_t (*func)(real,real,Interpolator),result_t& result) const;
 
+    // sets a fixed quadrature rule for the integrals over disjoint triangles
     void set_quadrature(std::vector<quadrature_2d> const& quad) {
         quad_2d = quad;
+        rule_2d = find_quadrature(quad);
+        quad_tolerance = 0.0;
     }
 
+    // distance-adaptive quadrature for the colocation integrals over triangles which do not contain the
+    // colocation point: for each pair, the rule of lowest precision p in triangle_quadratures is chosen for
+    // which (h/d)^(p+1) <= tolerance (h: longest edge of the triangle, d: distance of the colocation point
+    // from its center). Close pairs thus get up to quadrature_19, far pairs drop to 1 or 3 points.
+    // A tolerance <= 0 returns to the fixed rule set with the function above.
+    void set_quadrature(real tolerance);
+
     void set_quadrature(std::vector<quadrature_1d> const& quad) {
         quad_1d = quad;
+        duffy = std::make_shared<const DuffyTables>(quad);
     }
 
 private:
@@ -104,8 +186,24 @@ private:
     void integrate(std::vector<vec3> const& x,Triplet& tri_i,Triplet& tri_j,result_t& result) const;
 
 
+    // level of triangle_quadratures for the adaptive quadrature (zero if the quadrature is fixed)
+    size_t quadrature_level(real h2,real d2) const;
+    // rule to integrate over tri_y with respect to the point x (argument for with_quadrature)
+    size_t select_quadrature(vec3 x,Interpolator const& tri_y) const;
+
     std::vector<quadrature_2d> quad_2d;
     std::vector<quadrature_1d> quad_1d;
+
+    // index of quad_2d in triangle_quadratures (custom_quadrature if it is user defined), used to
+    // dispatch to the instantiations for the compile-time rules
+    size_t rule_2d;
+
+    // tabulated singular rules for quad_1d (shared between copies of the Integrator)
+    std::shared_ptr<const DuffyTables> duffy;
+
+    // adaptive quadrature: tolerance and maximum squared ratio h^2/d^2 for each level
+    real quad_tolerance;
+    std::vector<real> quad_ratio2;
     
 };
 
@@ -237,20 +335,22 @@ void Integrator::integrate_disjoint(Interpolator tri_x,Interpolator tri_y, resul
     result.G = 0.0;
     result.H = 0.0;
 
-    for(quadrature_2d const& q_i : quad_2d) {
-        for(quadrature_2d const& q_j : quad_2d) {
-            result_t temp(integrand<result_t>(
-                                q_i.x+q_i.y,q_i.y, // the addition of q_i/j.y is necessary to transform the quadrature to 
-                                q_j.x+q_j.y,q_j.y, // the other unit triangle with 45° corners at (0,0) and (1,1)
-                                tri_x,
-                                tri_y
-                                ));
+    with_quadrature(rule_2d,quad_2d,[&](auto const& quad) {
+        for(quadrature_2d const& q_i : quad) {
+            for(quadrature_2d const& q_j : quad) {
+                result_t temp(integrand<result_t>(
+                                    q_i.x+q_i.y,q_i.y, // the addition of q_i/j.y is necessary to transform the quadrature to 
+                                    q_j.x+q_j.y,q_j.y, // the other unit triangle with 45° corners at (0,0) and (1,1)
+                                    tri_x,
+                                    tri_y
+                                    ));
                                 
-            temp *= q_i.weight*q_j.weight;
+                temp *= q_i.weight*q_j.weight;
 
-            result += temp;
+                result += temp;
+            }
         }
-    }
+    });
 
     result *= tri_x.area()*tri_y.area();
 
@@ -265,79 +365,11 @@ void Integrator::integrate_identical(Interpolator tri_x, result_t& result) const
 
     using G_t = typename result_t::G_t;
 
-    for(quadrature_1d xi : quad_1d) {
-        for(quadrature_1d eta1 : quad_1d) {
-            for(quadrature_1d eta2 : quad_1d) {
-                for(quadrature_1d eta3 : quad_1d) {
-
-                    real weight = xi.weight
-                               *eta1.weight
-                               *eta2.weight
-                               *eta3.weight
-                               // and due to the variable change of duffy coords:
-                               *xi.x*xi.x*xi.x 
-                               *eta1.x*eta1.x
-                               *eta2.x;
-
-
-                    real A = xi.x;
-                    real B = A*eta1.x;
-                    real C = B*eta2.x;
-                    real D = C*eta3.x;
-
-                    // result.H is zero here: normal is orthogonal to y-x
-
-                    G_t temp_G(0.0);
-                    
-                    temp_G += integrand_identical<G_t>(  
-                                     A
-                                    ,A-B+C
-                                    ,A-D
-                                    ,A-B
-                                    ,tri_x);
-                               
-
-                    temp_G += integrand_identical<G_t>(  
-                                     A-D
-                                    ,A-B
-                                    ,A
-                                    ,A-B+C
-                                    ,tri_x);
-
-                    temp_G += integrand_identical<G_t>(  
-                                     A
-                                    ,B-C+D
-                                    ,A-C
-                                    ,B-C
-                                    ,tri_x);
-
-                    temp_G += integrand_identical<G_t>(  
-                                     A-C
-                                    ,B-C
-                                    ,A
-                                    ,B-C+D
-                                    ,tri_x);
-
-                    temp_G += integrand_identical<G_t>(  
-                                     A-D
-                                    ,B-D
-                                    ,A
-                                    ,B-C
-                                    ,tri_x);
-
-                    temp_G += integrand_identical<G_t>(  
-                                     A
-                                    ,B-C
-                                    ,A-D
-                                    ,B-D
-                                    ,tri_x);
-
-                    temp_G *= weight;
-
-                    result.G += temp_G;
-                }
-            }
-        }
+    // result.H is zero here: normal is orthogonal to y-x
+    for(DuffyPoint const& p : duffy->identical) {
+        G_t temp_G(integrand_identical<G_t>(p.x0,p.x1,p.y0,p.y1,tri_x));
+        temp_G *= p.weight;
+        result.G += temp_G;
     }
 
     result.G *= tri_x.area()*tri_x.area();
@@ -350,76 +382,10 @@ void Integrator::integrate_shared_edge(Interpolator tri_x,Interpolator tri_y, re
     result.G = 0.0;
     result.H = 0.0;
 
-    for(quadrature_1d xi : quad_1d) {
-        for(quadrature_1d eta1 : quad_1d) {
-            for(quadrature_1d eta2 : quad_1d) {
-                for(quadrature_1d eta3 : quad_1d) {
-
-                    real weight = xi.weight
-                               *eta1.weight
-                               *eta2.weight
-                               *eta3.weight
-                               // and due to the variable change of duffy coords:
-                               *xi.x*xi.x*xi.x
-                               *eta1.x*eta1.x;
-                               // attention! below we add eta2.x to the factor for some of the terms
-
-                    real A = xi.x;        // xi*...
-                    real B = A*eta1.x;    // eta1
-                    real C = B*eta2.x;    // eta1*eta2
-                    real D = C*eta3.x;    // eta1*eta2*eta3
-
-                    result_t temp;
-
-                    temp += integrand<result_t>(
-                                  A
-                                 ,B
-                                 ,A-D
-                                 ,C-D
-                                 ,tri_x
-                                 ,tri_y);
-
-                    temp += integrand<result_t>(
-                                  A-C
-                                 ,B-C
-                                 ,A
-                                 ,D
-                                 ,tri_x
-                                 ,tri_y);
-                    
-                    temp += integrand<result_t>(
-                                  A-D
-                                 ,C-D
-                                 ,A
-                                 ,B
-                                 ,tri_x
-                                 ,tri_y);
-                    
-                    temp += integrand<result_t>(
-                                  A-D
-                                 ,B-D
-                                 ,A
-                                 ,C
-                                 ,tri_x
-                                 ,tri_y);
-                    
-                    temp *= eta2.x;
-
-                    temp += integrand<result_t>(
-                                  A
-                                 ,B*eta3.x // special case here
-                                 ,A-C
-                                 ,B-C
-                                 ,tri_x
-                                 ,tri_y);
-
-                    temp *= weight;
-
-                    result += temp;
-
-                }
-            }
-        }
+    for(DuffyPoint const& p : duffy->shared_edge) {
+        result_t temp(integrand<result_t>(p.x0,p.x1,p.y0,p.y1,tri_x,tri_y));
+        temp *= p.weight;
+        result += temp;
     }
 
     result *= tri_x.area()*tri_y.area();
@@ -432,34 +398,10 @@ void Integrator::integrate_shared_vertex(Interpolator tri_x,Interpolator tri_y,
     result.G = 0.0;
     result.H = 0.0;
 
-    for(quadrature_1d xi : quad_1d) {
-        for(quadrature_1d eta1 : quad_1d) {
-            for(quadrature_1d eta2 : quad_1d) {
-                for(quadrature_1d eta3 : quad_1d) {
-
-                    real weight = xi.weight
-                               *eta1.weight
-                               *eta2.weight
-                               *eta3.weight
-                               // and due to the variable change of duffy coords:
-                               *xi.x*xi.x*xi.x
-                               *eta2.x;
-
-                    real A = xi.x;
-                    real B = A*eta1.x;
-                    real C = A*eta2.x; // different to the other cases!
-                    real D = C*eta3.x;
-
-                    result_t temp;
-                    temp += integrand<result_t>(A,B,C,D,tri_x,tri_y);
-                    temp += integrand<result_t>(C,D,A,B,tri_x,tri_y);
-                    temp *= weight;
-
-                    result += temp;
-
-                }
-            }
-        }
+    for(DuffyPoint const& p : duffy->shared_vertex) {
+        result_t temp(integrand<result_t>(p.x0,p.x1,p.y0,p.y1,tri_x,tri_y));
+        temp *= p.weight;
+        result += temp;
     }
 
     result *= tri_x.area()*tri_y.area();
@@ -473,16 +415,18 @@ void Integrator::integrate_disjoint_coloc(vec3 x,Interpolator tri_y,result_t& re
     result.G = 0.0;
     result.H = 0.0;
 
-    for(quadrature_2d q_y : quad_2d) {
-        result_t temp(integrand_coloc<result_t>(
-                            x,
-                            q_y.x+q_y.y,q_y.y, // transform to other unit triangle
-                            tri_y));
+    with_quadrature(select_quadrature(x,tri_y),quad_2d,[&](auto const& quad) {
+        for(quadrature_2d q_y : quad) {
+            result_t temp(integrand_coloc<result_t>(
+                                x,
+                                q_y.x+q_y.y,q_y.y, // transform to other unit triangle
+                                tri_y));
                             
-        temp *= q_y.weight;
+            temp *= q_y.weight;
 
-        result += temp;
-    }
+            result += temp;
+        }
+    });
     
 
     result *= tri_y.area();
@@ -495,16 +439,20 @@ void Integrator::integrate_disjoint_coloc_mir(vec3 x,Interpolator tri_y,result_t
     result.G = 0.0;
     result.H = 0.0;
 
-    for(quadrature_2d q_y : quad_2d) {
-        result_t temp(integrand_coloc_mir<result_t>(
-                            x,
-                            q_y.x+q_y.y,q_y.y, // transform to other unit triangle
-                            tri_y));
+    // the mirrored triangle is farther away from x than the original one (for x and tri_y on the same
+    // side of the mirror plane), so the rule is chosen w.r.t. the original triangle.
+    with_quadrature(select_quadrature(x,tri_y),quad_2d,[&](auto const& quad) {
+        for(quadrature_2d q_y : quad) {
+            result_t temp(integrand_coloc_mir<result_t>(
+                                x,
+                                q_y.x+q_y.y,q_y.y, // transform to other unit triangle
+                                tri_y));
                             
-        temp *= q_y.weight;
+            temp *= q_y.weight;
 
-        result += temp;
-    }
+            result += temp;
+        }
+    });
     
 
     result *= tri_y.area();
@@ -517,16 +465,18 @@ void Integrator::integrate_disjoint_coloc(vec3 x,Cubic const& tri_y,result_t& re
     result.G = 0.0;
     result.H = 0.0;
 
-    for(quadrature_2d q_y : quad_2d) {
-        result_t temp(integrand_coloc<result_t>(
-                            x,
-                            q_y.x,q_y.y,
-                            tri_y));
+    with_quadrature(rule_2d,quad_2d,[&](auto const& quad) {
+        for(quadrature_2d q_y : quad) {
+            result_t temp(integrand_coloc<result_t>(
+                                x,
+                                q_y.x,q_y.y,
+                                tri_y));
                             
-        temp *= q_y.weight;
+            temp *= q_y.weight;
 
-        result += temp;
-    }
+            result += temp;
+        }
+    });
 
     return;
 }
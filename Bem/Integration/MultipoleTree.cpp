@@ -0,0 +1,325 @@
+#include "MultipoleTree.hpp"
+#include "Interpolator.hpp"
+
+#include <vector>
+#include <algorithm> // for partition()
+#include <numeric>   // for iota()
+#include <omp.h>
+
+using namespace std;
+
+namespace Bem {
+
+// multipole expansion functions
+
+// The potential of a point charge at s (relative to the center) is expanded for |r| >> |s| as
+// 1/|r-s| = 1/r + s.r/r^3 + r.(3ss - s^2 I).r/(2r^5) + ...
+void Multipole::add_charge(vec3 const& s,real charge) {
+    q += charge;
+    d += charge*s;
+    real s2 = s.norm2();
+    Q[0] += charge*(3.0*s.x*s.x - s2);
+    Q[1] += charge*(3.0*s.y*s.y - s2);
+    Q[2] += charge*(3.0*s.z*s.z - s2);
+    Q[3] += charge*3.0*s.x*s.y;
+    Q[4] += charge*3.0*s.x*s.z;
+    Q[5] += charge*3.0*s.y*s.z;
+}
+
+// the double layer kernel is the derivative of the above expansion with respect to s in the
+// direction of the dipole vector (which is the normal of the triangle times the density)
+void Multipole::add_dipole(vec3 const& s,vec3 const& dipole) {
+    d += dipole;
+    real ns = 2.0*dipole.dot(s);
+    Q[0] += 6.0*dipole.x*s.x - ns;
+    Q[1] += 6.0*dipole.y*s.y - ns;
+    Q[2] += 6.0*dipole.z*s.z - ns;
+    Q[3] += 3.0*(dipole.x*s.y + s.x*dipole.y);
+    Q[4] += 3.0*(dipole.x*s.z + s.x*dipole.z);
+    Q[5] += 3.0*(dipole.y*s.z + s.y*dipole.z);
+}
+
+// translation of an expansion from center+t to center
+void Multipole::add_shifted(Multipole const& other,vec3 const& t) {
+    q += other.q;
+    d += other.d + other.q*t;
+    real t2 = t.norm2();
+    real dt = 2.0*other.d.dot(t);
+    Q[0] += other.Q[0] + 6.0*other.d.x*t.x - dt + other.q*(3.0*t.x*t.x - t2);
+    Q[1] += other.Q[1] + 6.0*other.d.y*t.y - dt + other.q*(3.0*t.y*t.y - t2);
+    Q[2] += other.Q[2] + 6.0*other.d.z*t.z - dt + other.q*(3.0*t.z*t.z - t2);
+    Q[3] += other.Q[3] + 3.0*(other.d.x*t.y + t.x*other.d.y) + other.q*3.0*t.x*t.y;
+    Q[4] += other.Q[4] + 3.0*(other.d.x*t.z + t.x*other.d.z) + other.q*3.0*t.x*t.z;
+    Q[5] += other.Q[5] + 3.0*(other.d.y*t.z + t.y*other.d.z) + other.q*3.0*t.y*t.z;
+}
+
+real Multipole::evaluate(vec3 const& r) const {
+    real inv_r2 = 1.0/r.norm2();
+    real inv_r = sqrt(inv_r2);
+    real inv_r3 = inv_r*inv_r2;
+    real rQr = Q[0]*r.x*r.x + Q[1]*r.y*r.y + Q[2]*r.z*r.z
+             + 2.0*(Q[3]*r.x*r.y + Q[4]*r.x*r.z + Q[5]*r.y*r.z);
+    return q*inv_r + d.dot(r)*inv_r3 + 0.5*rQr*inv_r3*inv_r2;
+}
+
+
+// MultipoleTree
+
+MultipoleTree::MultipoleTree(vector<vec3> const& x,vector<Triplet> const& trigs,Integrator const& inter,real theta,size_t leaf_size)
+    :x(x),trigs(trigs),inter(inter),theta(theta),mirror(false),cache(inter.make_triangle_cache(x,trigs)) {
+    build(leaf_size);
+}
+
+// builds the octree by recursively splitting the bounding box of the triangle centers
+void MultipoleTree::build(size_t leaf_size) {
+    size_t M(trigs.size());
+    trig_order = vector<size_t>(M);
+    iota(trig_order.begin(),trig_order.end(),0);
+
+    vector<vec3> centers(M);
+    for(size_t j(0);j<M;++j) {
+        Triplet t(trigs[j]);
+        centers[j] = (1.0/3.0)*(x[t.a]+x[t.b]+x[t.c]);
+    }
+
+    nodes.clear();
+    Node root;
+    root.begin = 0;
+    root.end = M;
+    nodes.push_back(root);
+
+    // the children are always appended after their parent, so we can simply
+    // process the nodes in the order of the array.
+    for(size_t n(0);n<nodes.size();++n) {
+        size_t begin = nodes[n].begin;
+        size_t end = nodes[n].end;
+
+        // bounding box of the vertices of all triangles
+        vec3 lo(x[trigs[trig_order[begin]].a]), hi(lo);
+        for(size_t k(begin);k<end;++k) {
+            Triplet t(trigs[trig_order[k]]);
+            for(size_t i : {t.a,t.b,t.c}) {
+                lo = vec3(min(lo.x,x[i].x),min(lo.y,x[i].y),min(lo.z,x[i].z));
+                hi = vec3(max(hi.x,x[i].x),max(hi.y,x[i].y),max(hi.z,x[i].z));
+            }
+        }
+        vec3 center = 0.5*(lo+hi);
+        real radius(0.0);
+        for(size_t k(begin);k<end;++k) {
+            Triplet t(trigs[trig_order[k]]);
+            for(size_t i : {t.a,t.b,t.c})
+                radius = max(radius,(x[i]-center).norm2());
+        }
+        nodes[n].center = center;
+        nodes[n].radius = sqrt(radius);
+        nodes[n].child = 0;
+        nodes[n].num_children = 0;
+
+        if(end - begin <= leaf_size) continue;
+
+        // sort the triangles into the eight octants
+        auto first = trig_order.begin()+begin;
+        auto last = trig_order.begin()+end;
+        auto mid_x = partition(first,last,[&](size_t j){ return centers[j].x < center.x; });
+        auto mid_y0 = partition(first,mid_x,[&](size_t j){ return centers[j].y < center.y; });
+        auto mid_y1 = partition(mid_x,last,[&](size_t j){ return centers[j].y < center.y; });
+        vector<vector<size_t>::iterator> bounds = {first,
+            partition(first,mid_y0,[&](size_t j){ return centers[j].z < center.z; }),mid_y0,
+            partition(mid_y0,mid_x,[&](size_t j){ return centers[j].z < center.z; }),mid_x,
+            partition(mid_x,mid_y1,[&](size_t j){ return centers[j].z < center.z; }),mid_y1,
+            partition(mid_y1,last,[&](size_t j){ return centers[j].z < center.z; }),last};
+
+        // all triangle centers coincide -> cannot be split any further
+        size_t num_nonempty(0);
+        for(size_t k(0);k<8;++k)
+            if(bounds[k] != bounds[k+1]) num_nonempty++;
+        if(num_nonempty < 2) continue;
+
+        nodes[n].child = nodes.size();
+        nodes[n].num_children = num_nonempty;
+        for(size_t k(0);k<8;++k) {
+            if(bounds[k] == bounds[k+1]) continue;
+            Node child;
+            child.begin = bounds[k] - trig_order.begin();
+            child.end = bounds[k+1] - trig_order.begin();
+            nodes.push_back(child);
+        }
+    }
+}
+
+void MultipoleTree::build_colocation(bool mirror_) {
+    mirror = mirror_;
+    size_t N(x.size());
+
+    far_nodes = vector<vector<size_t>>(N);
+    far_nodes_mir = vector<vector<size_t>>(mirror ? N : 0);
+
+    vector<vector<Eigen::Triplet<real>>> G_trips(omp_get_max_threads()), H_trips(omp_get_max_threads());
+
+    #pragma omp parallel
+    {
+    vector<Eigen::Triplet<real>>& G_loc = G_trips[omp_get_thread_num()];
+    vector<Eigen::Triplet<real>>& H_loc = H_trips[omp_get_thread_num()];
+    vector<size_t> stack;
+
+    #pragma omp for schedule(dynamic,64)
+    for(size_t i = 0;i<N;++i) {
+
+        // the direct part and (if present) the contribution of the mirrored mesh, which is equal
+        // to the contribution of the original mesh w.r.t. the mirrored colocation point.
+        for(size_t pass(0);pass<(mirror ? 2 : 1);++pass) {
+            vec3 target = x[i];
+            if(pass == 1) target.x = -target.x;
+            vector<size_t>& far_list = (pass == 0) ? far_nodes[i] : far_nodes_mir[i];
+
+            stack.push_back(0);
+            while(not stack.empty()) {
+                Node const& node = nodes[stack.back()];
+                size_t n = stack.back();
+                stack.pop_back();
+
+                if(far(node,target)) {
+                    far_list.push_back(n);
+                } else if(node.num_children > 0) {
+                    for(size_t k(0);k<node.num_children;++k)
+                        stack.push_back(node.child+k);
+                } else {
+                    for(size_t k(node.begin);k<node.end;++k) {
+                        Triplet t(trigs[trig_order[k]]);
+                        HomoPair<LinElm> result;
+                        if(pass == 0) inter.integrate_Lin_coloc_elements(x,cache,i,trig_order[k],result);
+                        else          inter.integrate_Lin_point_elements(cache,target,trig_order[k],result);
+
+                        for(size_t l(0);l<3;++l) {
+                            G_loc.push_back(Eigen::Triplet<real>(i,t[l],result.G[l]));
+                            H_loc.push_back(Eigen::Triplet<real>(i,t[l],result.H[l]));
+                        }
+                    }
+                }
+            }
+        }
+    }
+    }
+
+    vector<Eigen::Triplet<real>> G_all,H_all;
+    for(size_t k(0);k<G_trips.size();++k) {
+        G_all.insert(G_all.end(),G_trips[k].begin(),G_trips[k].end());
+        H_all.insert(H_all.end(),H_trips[k].begin(),H_trips[k].end());
+    }
+    G_near = Eigen::SparseMatrix<real,Eigen::RowMajor>(N,N);
+    H_near = Eigen::SparseMatrix<real,Eigen::RowMajor>(N,N);
+    G_near.setFromTriplets(G_all.begin(),G_all.end());
+    H_near.setFromTriplets(H_all.begin(),H_all.end());
+}
+
+// upward pass: the expansions of the leaves are computed from the quadrature
+// points and then translated to the centers of their parent nodes.
+void MultipoleTree::compute_moments(Eigen::VectorXd const& sigma,Eigen::VectorXd const& mu) const {
+    bool single(sigma.size() > 0), dipole(mu.size() > 0);
+    moments = vector<Multipole>(nodes.size());
+
+    #pragma omp parallel for schedule(dynamic,16)
+    for(size_t n = 0;n<nodes.size();++n) {
+        Node const& node = nodes[n];
+        if(node.num_children > 0) continue;
+        Multipole& mom = moments[n];
+        for(size_t k(node.begin);k<node.end;++k) {
+            size_t j = trig_order[k];
+            Triplet t(trigs[j]);
+            // (with adaptive quadrature, the most precise rule is used)
+            for(size_t l(cache.level_begin[cache.level_begin.size()-2]);l<cache.num_quad;++l) {
+                vec3 s = cache.pos[j*cache.num_quad+l] - node.center;
+                LinElm const& w = cache.weights[j*cache.num_quad+l];
+                if(single) mom.add_charge(s,w[0]*sigma(t.a) + w[1]*sigma(t.b) + w[2]*sigma(t.c));
+                if(dipole) mom.add_dipole(s,(w[0]*mu(t.a) + w[1]*mu(t.b) + w[2]*mu(t.c))*cache.normals[j]);
+            }
+        }
+    }
+
+    for(size_t n(nodes.size());n-->0;) {
+        Node const& node = nodes[n];
+        for(size_t k(0);k<node.num_children;++k) {
+            size_t c = node.child+k;
+            moments[n].add_shifted(moments[c],nodes[c].center-node.center);
+        }
+    }
+}
+
+Eigen::VectorXd MultipoleTree::multiply(Eigen::VectorXd const& v,bool single_layer) const {
+    assert(size_t(v.size()) == x.size());
+    if(single_layer) compute_moments(v,Eigen::VectorXd());
+    else             compute_moments(Eigen::VectorXd(),v);
+
+    size_t N(x.size());
+    Eigen::VectorXd result = single_layer ? Eigen::VectorXd(G_near*v) : Eigen::VectorXd(H_near*v);
+
+    #pragma omp parallel for schedule(dynamic,64)
+    for(size_t i = 0;i<N;++i) {
+        real val(0.0);
+        for(size_t n : far_nodes[i])
+            val += moments[n].evaluate(x[i] - nodes[n].center);
+        if(mirror) {
+            vec3 target = x[i];
+            target.x = -target.x;
+            for(size_t n : far_nodes_mir[i])
+                val += moments[n].evaluate(target - nodes[n].center);
+        }
+        result(i) += val;
+    }
+    return result;
+}
+
+vector<real> MultipoleTree::exterior_potential(vector<vec3> const& targets,Eigen::VectorXd const& phi,Eigen::VectorXd const& psi) const {
+    assert(size_t(phi.size()) == x.size() and size_t(psi.size()) == x.size());
+    compute_moments(-psi,phi);
+
+    size_t N(targets.size());
+    vector<real> result(N);
+
+    #pragma omp parallel
+    {
+    vector<size_t> stack;
+
+    #pragma omp for schedule(dynamic,64)
+    for(size_t i = 0;i<N;++i) {
+        real val(0.0);
+        stack.push_back(0);
+        while(not stack.empty()) {
+            size_t n = stack.back();
+            Node const& node = nodes[n];
+            stack.pop_back();
+
+            if(far(node,targets[i])) {
+                val += moments[n].evaluate(targets[i] - node.center);
+            } else if(node.num_children > 0) {
+                for(size_t k(0);k<node.num_children;++k)
+                    stack.push_back(node.child+k);
+            } else {
+                for(size_t k(node.begin);k<node.end;++k) {
+                    Triplet t(trigs[trig_order[k]]);
+                    HomoPair<LinElm> e;
+                    inter.integrate_Lin_point_elements(cache,targets[i],trig_order[k],e);
+                    for(size_t l(0);l<3;++l)
+                        val += e.H[l]*phi(t[l]) - e.G[l]*psi(t[l]);
+                }
+            }
+        }
+        result[i] = val/(4.0*M_PI);
+    }
+    }
+    return result;
+}
+
+Eigen::VectorXd MultipoleTree::multiply_G(Eigen::VectorXd const& v) const {
+    return multiply(v,true);
+}
+
+Eigen::VectorXd MultipoleTree::multiply_H(Eigen::VectorXd const& v) const {
+    return multiply(v,false);
+}
+
+Eigen::VectorXd MultipoleTree::diagonal_G() const {
+    return G_near.diagonal();
+}
+
+} // namespace Bem
@@ -0,0 +1,115 @@
+#ifndef MULTIPOLETREE_HPP
+#define MULTIPOLETREE_HPP
+
+#include <vector>
+#include "../basic/Bem.hpp"
+#include "Integrator.hpp"
+#include "ResultTypes.hpp"
+#include "ColocMatrices.hpp"
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+namespace Bem {
+
+// The MultipoleTree is an octree over the triangles of a mesh. It is used to evaluate the single
+// layer (kernel 1/r) and the double layer potential (kernel -(y-x).n/r^3) of piecewise linear
+// densities on the mesh in O(N log N) instead of O(N^2) operations. The quadrature points of the
+// triangles in each node are summarized by a cartesian multipole expansion (up to quadrupole
+// order) around the center of the node. A node is evaluated by its expansion if the target point
+// is far enough away from it (radius < theta*distance), otherwise its children are visited. The
+// triangles of the leaves which are close to the target (the near field) are integrated exactly
+// with the Integrator, including the singular quadrature if the target is a vertex of the triangle.
+//
+// For the colocation method the near field integrals and the lists of far nodes of each vertex are
+// computed once in build_colocation(); then G*v and H*v can be evaluated repeatedly (e.g. by an
+// iterative solver) without ever storing the dense matrices. Note that the solid angle term on the
+// diagonal of H is not included (it has to be added by the simulation, as in assemble_matrices).
+// The same expansions are used to evaluate the potential at points off the surface.
+
+// multipole expansion of the potential: q/r + d.r/r^3 + r.Q.r/(2r^5)
+// the quadrupole is stored in the order xx,yy,zz,xy,xz,yz.
+struct Multipole {
+    real q;
+    vec3 d;
+    std::array<real,6> Q;
+
+    Multipole() :q(0.0),d(),Q({0.0,0.0,0.0,0.0,0.0,0.0}) {}
+
+    void add_charge(vec3 const& s,real charge);
+    void add_dipole(vec3 const& s,vec3 const& dipole);
+    void add_shifted(Multipole const& other,vec3 const& t); // other is centered at center+t
+    real evaluate(vec3 const& r) const;                     // r is relative to the center
+};
+
+class MultipoleTree : public ColocMatrices {
+public:
+
+    // the tree is built over the triangles trigs with vertex positions x. theta is the
+    // opening angle of the expansions (accuracy parameter, smaller is more accurate) and
+    // leaf_size the maximum number of triangles in a leaf.
+    MultipoleTree(std::vector<vec3> const& x,std::vector<Triplet> const& trigs,Integrator const& inter,real theta = 0.3,size_t leaf_size = 16);
+
+    // computes the near field matrices and the lists of far nodes for all vertices of the
+    // mesh as colocation points. If mirror is true, the image of the mesh w.r.t. the plane
+    // x = 0 is taken into account too (see MIRROR_MESH in LinLinSim.hpp).
+    void build_colocation(bool mirror);
+
+    // matrix-vector products with the colocation matrices G and H (without the solid angle term)
+    virtual Eigen::VectorXd multiply_G(Eigen::VectorXd const& v) const override;
+    virtual Eigen::VectorXd multiply_H(Eigen::VectorXd const& v) const override;
+
+    // potential (-G*psi + H*phi)/(4pi) of the densities phi and psi on the mesh at the given points,
+    // which must not lie on the surface (see Integrator::get_exterior_potential). Independent
+    // of build_colocation(); the mirror is not taken into account.
+    std::vector<real> exterior_potential(std::vector<vec3> const& targets,Eigen::VectorXd const& phi,Eigen::VectorXd const& psi) const;
+
+    // diagonal of G (stems entirely from the near field)
+    virtual Eigen::VectorXd diagonal_G() const override;
+
+    virtual size_t size() const override {
+        return x.size();
+    }
+
+private:
+
+    struct Node {
+        vec3 center;
+        real radius;
+        size_t begin, end;   // range in trig_order
+        size_t child;        // index of the first child (the children are stored contiguously)
+        size_t num_children; // zero for leaves
+    };
+
+    void build(size_t leaf_size);
+    void compute_moments(Eigen::VectorXd const& sigma,Eigen::VectorXd const& mu) const;
+    Eigen::VectorXd multiply(Eigen::VectorXd const& v,bool single_layer) const;
+
+    bool far(Node const& node,vec3 const& target) const {
+        return node.radius < theta*(target - node.center).norm();
+    }
+
+    std::vector<vec3> x;
+    std::vector<Triplet> trigs;
+    Integrator inter;
+    real theta;
+    bool mirror;
+
+    std::vector<Node> nodes;
+    std::vector<size_t> trig_order;
+
+    // quadrature points of each triangle, their integration weights multiplied
+    // by the three basis functions, and the triangle normals.
+    TriangleCache cache;
+
+    // colocation data
+    Eigen::SparseMatrix<real,Eigen::RowMajor> G_near,H_near;
+    std::vector<std::vector<size_t>> far_nodes, far_nodes_mir;
+
+    // the expansions depend on the density which is currently evaluated
+    mutable std::vector<Multipole> moments;
+};
+
+} // namespace Bem
+
+#endif // MULTIPOLETREE_HPP
@@ -4,6 +4,8 @@
 #include "../basic/Bem.hpp"
 
 #include <vector>
+#include <array>
+#include <cstring>
 
 namespace Bem {
 
@@ -13,21 +15,25 @@ namespace Bem {
 // quadrature points. These vectors are also defined in this file for different precision
 // levels. Note that the quadrature rules for triangles assume the unit triangle with 
 // vertex coordinates (0,0), (1,0) and (0,1).
+// Each rule is first defined as constexpr std::array (name_rule), from which the vector
+// is copied. The integration loops over triangles are instantiated for the arrays (see with_quadrature
+// at the end of this file), such that their trip counts are known at compile time.
 
 struct quadrature_1d {
     real x, weight;
-    quadrature_1d(real x,real weight)
+    constexpr quadrature_1d(real x,real weight)
         :x(x),weight(weight) {}
 };
 
 // Gaussian quadrature rules taken from: https://pomax.github.io/bezierinfo/legendre-gauss.html
-const std::vector<quadrature_1d> gauss_3 = {
+constexpr std::array<quadrature_1d,3> gauss_3_rule = {
     quadrature_1d(0.5*(1.0+0.0000000000000000),0.5*0.8888888888888888),
     quadrature_1d(0.5*(1.0-0.7745966692414834),0.5*0.5555555555555556),
     quadrature_1d(0.5*(1.0+0.7745966692414834),0.5*0.5555555555555556)
 };
+const std::vector<quadrature_1d> gauss_3(gauss_3_rule.begin(),gauss_3_rule.end());
 
-const std::vector<quadrature_1d> gauss_7 = {
+constexpr std::array<quadrature_1d,7> gauss_7_rule = {
     quadrature_1d(0.5*(1.0+0.0000000000000000),0.5*0.4179591836734694),
     quadrature_1d(0.5*(1.0+0.4058451513773972),0.5*0.3818300505051189),
     quadrature_1d(0.5*(1.0-0.4058451513773972),0.5*0.3818300505051189),
@@ -36,10 +42,11 @@ const std::vector<quadrature_1d> gauss_7 = {
     quadrature_1d(0.5*(1.0-0.9491079123427585),0.5*0.1294849661688697),
     quadrature_1d(0.5*(1.0+0.9491079123427585),0.5*0.1294849661688697)
 };
+const std::vector<quadrature_1d> gauss_7(gauss_7_rule.begin(),gauss_7_rule.end());
 
  	
 
-const std::vector<quadrature_1d> gauss_12 = {
+constexpr std::array<quadrature_1d,12> gauss_12_rule = {
     quadrature_1d(0.5*(1.0-0.1252334085114689),0.5*0.2491470458134028),
     quadrature_1d(0.5*(1.0+0.1252334085114689),0.5*0.2491470458134028),
     quadrature_1d(0.5*(1.0-0.3678314989981802),0.5*0.2334925365383548),
@@ -53,13 +60,14 @@ const std::vector<quadrature_1d> gauss_12 = {
     quadrature_1d(0.5*(1.0-0.9815606342467192),0.5*0.0471753363865118),
     quadrature_1d(0.5*(1.0+0.9815606342467192),0.5*0.0471753363865118)
 };
+const std::vector<quadrature_1d> gauss_12(gauss_12_rule.begin(),gauss_12_rule.end());
 
 
 struct quadrature_2d {
     real x;
     real y;
     real weight;
-    quadrature_2d(real x,real y,real weight)
+    constexpr quadrature_2d(real x,real y,real weight)
         :x(x),y(y),weight(weight) {}
 };
 
@@ -68,24 +76,27 @@ struct quadrature_2d {
 
 using QuadratureList_2d = std::vector<quadrature_2d>;
 
-const QuadratureList_2d quadrature_1 = { // prec. 1
+constexpr std::array<quadrature_2d,1> quadrature_1_rule = { // prec. 1
     quadrature_2d(1.0/3.0,1.0/3.0,0.5)
 };
+const QuadratureList_2d quadrature_1(quadrature_1_rule.begin(),quadrature_1_rule.end());
 
-const QuadratureList_2d quadrature_3 = { // prec. 2
+constexpr std::array<quadrature_2d,3> quadrature_3_rule = { // prec. 2
     quadrature_2d(0.66666666666666666667,  0.16666666666666666667 , 1.0/6.0),
     quadrature_2d(0.16666666666666666667,  0.66666666666666666667 , 1.0/6.0),
     quadrature_2d(0.16666666666666666667,  0.16666666666666666667 , 1.0/6.0)
 };
+const QuadratureList_2d quadrature_3(quadrature_3_rule.begin(),quadrature_3_rule.end());
 
-const QuadratureList_2d quadrature_4 = { // prec. 3
+constexpr std::array<quadrature_2d,4> quadrature_4_rule = { // prec. 3
     quadrature_2d(1.0/3.0, 1.0/3.0, -0.56250000000000000000*0.5),
     quadrature_2d(0.6,     0.2,      0.52083333333333333333*0.5),
     quadrature_2d(0.2,     0.6,      0.52083333333333333333*0.5),
     quadrature_2d(0.2,     0.2,      0.52083333333333333333*0.5)
 };
+const QuadratureList_2d quadrature_4(quadrature_4_rule.begin(),quadrature_4_rule.end());
 
-const QuadratureList_2d quadrature_7 = { // prec. 5
+constexpr std::array<quadrature_2d,7> quadrature_7_rule = { // prec. 5
     quadrature_2d(0.33333333333333333,  0.33333333333333333, 0.22500000000000000*0.5),
     quadrature_2d(0.79742698535308720,  0.10128650732345633, 0.12593918054482717*0.5),
     quadrature_2d(0.10128650732345633,  0.79742698535308720, 0.12593918054482717*0.5),
@@ -94,8 +105,9 @@ const QuadratureList_2d quadrature_7 = { // prec. 5
     quadrature_2d(0.47014206410511505,  0.05971587178976981, 0.13239415278850616*0.5),
     quadrature_2d(0.47014206410511505,  0.47014206410511505, 0.13239415278850616*0.5)
 };
+const QuadratureList_2d quadrature_7(quadrature_7_rule.begin(),quadrature_7_rule.end());
 
-const QuadratureList_2d quadrature_9 = { // prec. 6
+constexpr std::array<quadrature_2d,9> quadrature_9_rule = { // prec. 6
     quadrature_2d(0.124949503233232,  0.437525248383384, 0.205950504760887*0.5),
     quadrature_2d(0.437525248383384,  0.124949503233232, 0.205950504760887*0.5),
     quadrature_2d(0.437525248383384,  0.437525248383384, 0.205950504760887*0.5),
@@ -106,8 +118,9 @@ const QuadratureList_2d quadrature_9 = { // prec. 6
     quadrature_2d(0.037477420750088,  0.797112651860071, 0.063691414286223*0.5),
     quadrature_2d(0.037477420750088,  0.165409927389841, 0.063691414286223*0.5)
 };
+const QuadratureList_2d quadrature_9(quadrature_9_rule.begin(),quadrature_9_rule.end());
 
-const QuadratureList_2d quadrature_13 = { // prec. 7
+constexpr std::array<quadrature_2d,13> quadrature_13_rule = { // prec. 7
     quadrature_2d(0.333333333333333,  0.333333333333333, -0.149570044467670*0.5),
     quadrature_2d(0.479308067841923,  0.260345966079038, 0.175615257433204*0.5),
     quadrature_2d(0.260345966079038,  0.479308067841923, 0.175615257433204*0.5),
@@ -122,8 +135,9 @@ const QuadratureList_2d quadrature_13 = { // prec. 7
     quadrature_2d(0.048690315425316,  0.638444188569809, 0.077113760890257*0.5),
     quadrature_2d(0.048690315425316,  0.312865496004875, 0.077113760890257*0.5)
 };
+const QuadratureList_2d quadrature_13(quadrature_13_rule.begin(),quadrature_13_rule.end());
 
-const QuadratureList_2d quadrature_19 = { // prec. 9
+constexpr std::array<quadrature_2d,19> quadrature_19_rule = { // prec. 9
     quadrature_2d(0.33333333333333331   ,  0.33333333333333331   , 9.71357962827961025e-2*0.5),
     quadrature_2d(2.06349616025259287e-2,  0.48968251919873701   , 3.13347002271398278e-2*0.5),
     quadrature_2d(0.48968251919873701   ,  2.06349616025259287e-2, 3.13347002271398278e-2*0.5),
@@ -144,6 +158,7 @@ const QuadratureList_2d quadrature_19 = { // prec. 9
     quadrature_2d(0.22196298916076573   ,  0.74119859878449801   , 4.32835393772893970e-2*0.5),
     quadrature_2d(0.22196298916076573   ,  3.68384120547362581e-2, 4.32835393772893970e-2*0.5)
 };
+const QuadratureList_2d quadrature_19(quadrature_19_rule.begin(),quadrature_19_rule.end());
 
 // list containing the pointers to the above quadrature for easy switching
 // if some level of detail adaptions want to be implemented.
@@ -157,6 +172,43 @@ const std::vector<QuadratureList_2d const *> triangle_quadratures = {
     &quadrature_19  // 6
 };
 
+// polynomial precision of the rules in triangle_quadratures
+const std::vector<size_t> triangle_quadrature_precisions = { 1, 2, 3, 5, 6, 7, 9 };
+
+const size_t custom_quadrature = size_t(-1);
+
+// index of the rule quad in triangle_quadratures (compared by value), custom_quadrature if it
+// is none of them
+inline size_t find_quadrature(QuadratureList_2d const& quad) {
+    for(size_t k(0);k<triangle_quadratures.size();++k) {
+        QuadratureList_2d const& rule(*triangle_quadratures[k]);
+        if(rule.size() != quad.size()) continue;
+        bool equal(true);
+        for(size_t l(0);l<rule.size() and equal;++l) {
+            equal = std::memcmp(&rule[l],&quad[l],sizeof(quadrature_2d)) == 0;
+        }
+        if(equal) return k;
+    }
+    return custom_quadrature;
+}
+
+// runtime dispatch to the compile-time rules: calls func with triangle_quadratures[rule] as
+// std::array, or with the vector quad if rule is custom_quadrature.
+// func is typically a generic lambda containing the integration loop.
+template<typename func_t>
+inline void with_quadrature(size_t rule,QuadratureList_2d const& quad,func_t&& func) {
+    switch(rule) {
+        case 0:  func(quadrature_1_rule);  break;
+        case 1:  func(quadrature_3_rule);  break;
+        case 2:  func(quadrature_4_rule);  break;
+        case 3:  func(quadrature_7_rule);  break;
+        case 4:  func(quadrature_9_rule);  break;
+        case 5:  func(quadrature_13_rule); break;
+        case 6:  func(quadrature_19_rule); break;
+        default: func(quad);
+    }
+}
+
 } // namespace Bem
 
 #endif // QUADRATURE_HPP
\ No newline at end of file
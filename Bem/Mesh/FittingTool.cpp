@@ -1,6 +1,7 @@
 #include "FittingTool.hpp"
 #include <cassert>
 #include <iostream>
+#include <omp.h>
 
 using namespace std;
 
@@ -55,53 +56,74 @@ vec3 CoordSystem::world_coords_relative(real x, real y, real z) const {
     return vec3(x*X + y*Y + z*Z);
 }
 
-void FittingTool::compute_quadratic_fit(vec3 normal, vec3 center_vertex, std::vector<vec3> vertices) {
-    using Eigen::MatrixXd;
-    using Eigen::VectorXd;
+namespace {
+
+// weighted least squares fit of z = p[0] + p[1]*x + p[2]*y + p[3]*x*y + p[4]*x*x + p[5]*y*y to the n points
+// point(k), in the coordinate system with origin center_vertex and z axis normal. The normal equations
+// have fixed size, such that the fit doesn't allocate any memory.
+template<typename point_t>
+void quadratic_fit(CoordSystem& system, real* p, vec3 const& normal, vec3 const& center_vertex, size_t n, point_t const& point) {
+    typedef Eigen::Matrix<real,6,6> Matrix6;
+    typedef Eigen::Matrix<real,6,1> Vector6;
 
     system.set(center_vertex,normal);
     system.swap_xz();
 
     real d(0.0);
-    for(vec3& vec : vertices) {
-        vec = system.transform(vec);
-        d += vec.norm();
-    }
-    d /= double(vertices.size());
+    for(size_t k(0);k<n;++k)
+        d += system.transform(point(k)).norm();
+    d /= double(n);
 
-    size_t n(vertices.size());
     if(n<6) {
         //if(n<5) cerr << "Danger: less than 5 points were given to FittingTool!" << endl;
         //else cerr << "Warning: less than 6 points were given to FittingTool!" << endl;
     }
-    MatrixXd B(n,6);
-    MatrixXd W = MatrixXd::Zero(n,n);
-    VectorXd zeta(n);
-    for(size_t i(0);i<n;++i){
-        vec3 const& vec(vertices[i]);
-        
-        B(i,0) = 1.0;
-        B(i,1) = vec.x;
-        B(i,2) = vec.y;
-        B(i,3) = vec.x*vec.y;
-        B(i,4) = vec.x*vec.x;
-        B(i,5) = vec.y*vec.y;
-
-        zeta(i) = vec.z;
+    Matrix6 A = Matrix6::Zero();
+    Vector6 b = Vector6::Zero();
+    for(size_t k(0);k<n;++k) {
+        vec3 vec(system.transform(point(k)));
+
+        Vector6 B;
+        B << 1.0, vec.x, vec.y, vec.x*vec.y, vec.x*vec.x, vec.y*vec.y;
+
         // the weight of each point depends exponentially on its distance to the origin
-        W(i,i) = exp(-vec.norm()/(2*d));
+        real w(exp(-vec.norm()/(2*d)));
+
+        A.noalias() += (w*B)*B.transpose();
+        b += (w*vec.z)*B;
     }
 
-    MatrixXd A = B.transpose()*W*B;
-    VectorXd b = B.transpose()*W*zeta;
+    Eigen::FullPivLU<Matrix6> solver(A);
+    Vector6 x = solver.solve(b);
+
+    for(size_t i(0);i<6;++i)
+        p[i] = x(i);
+}
+
+} // namespace
+
+void FittingTool::compute_quadratic_fit(vec3 normal, vec3 center_vertex, std::vector<vec3> const& vertices) {
+    fitting_params.resize(6);
+    quadratic_fit(system,fitting_params.data(),normal,center_vertex,vertices.size(),[&vertices](size_t k) {
+        return vertices[k];
+    });
+}
 
-    Eigen::FullPivLU<Eigen::MatrixXd> solver;
-    solver.compute(A);
-    VectorXd x = solver.solve(b);
-    
-    fitting_params.clear();
-    for(size_t i(0);i<6;++i){
-        fitting_params.push_back(x(i));
+void compute_quadratic_fits(QuadraticFits& fits, Mesh const& mesh, vector<vec3> const& normals, Adjacency const& neighbours, size_t num_threads) {
+    assert(normals.size() == mesh.verts.size() and neighbours.size() == mesh.verts.size());
+    size_t n(mesh.verts.size());
+    fits.systems.resize(n);
+    fits.params.resize(6*n);
+
+    omp_set_num_threads(num_threads);
+
+    #pragma omp parallel for
+    for(size_t i = 0;i<n;++i) {
+        Adjacency::Row row(neighbours[i]);
+        // the vertex itself, followed by its neighbours
+        quadratic_fit(fits.systems[i],&fits.params[6*i],normals[i],mesh.verts[i],row.size()+1,[&](size_t k) {
+            return k == 0 ? mesh.verts[i] : mesh.verts[row[k-1]];
+        });
     }
 }
 
@@ -2,6 +2,7 @@
 #define FITTINGTOOL_HPP
 
 #include "../basic/Bem.hpp"
+#include "Mesh.hpp"
 
 #include <iostream>
 #include <vector>
@@ -68,7 +69,7 @@ public:
     using vec3 = Bem::vec3;
 
     // fills the vector "fitting_params"
-    void compute_quadratic_fit(vec3 normal, vec3 center_vertex, std::vector<vec3> vertices);
+    void compute_quadratic_fit(vec3 normal, vec3 center_vertex, std::vector<vec3> const& vertices);
     vec3 get_position(real x, real y) const;
     real get_curvature() const;
     vec3 get_normal() const;
@@ -91,6 +92,28 @@ private:
     CoordSystem system;
 };
 
+// The QuadraticFits hold the fits at all vertices of a mesh in flat arrays (see compute_quadratic_fits):
+// fit i has the coordinate system systems[i] and the parameters params[6*i],...,params[6*i+5], which
+// are the same as the ones of a FittingTool fitted to the same points.
+struct QuadraticFits {
+    std::vector<CoordSystem> systems;
+    std::vector<real> params;
+
+    size_t size() const {
+        return systems.size();
+    }
+
+    // see FittingTool::get_position
+    vec3 get_position(size_t i, real x, real y) const {
+        real const* p(params.data() + 6*i);
+        return systems[i].world_coords(x,y,p[0] + p[1]*x + p[2]*y + p[3]*x*y + p[4]*x*x + p[5]*y*y);
+    }
+};
+
+// computes the quadratic fit at each vertex i of mesh (with normal normals[i]) over the vertex itself and
+// its neighbours (e.g. MeshTopology::neighbours or two_ring) on num_threads OpenMP threads.
+void compute_quadratic_fits(QuadraticFits& fits, Mesh const& mesh, std::vector<vec3> const& normals, Adjacency const& neighbours, size_t num_threads = 100);
+
 } // namespace Bem
 
 #endif // FITTINGTOOL_HPP
@@ -9,116 +9,80 @@ using namespace std;
 
 namespace Bem {
 
-const size_t HalfedgeMesh::npos = -1;
-
-HalfedgeMesh::~HalfedgeMesh() {
-    clear();
-}
+const uint32_t HalfedgeMesh::npos = -1;
 
 void HalfedgeMesh::clear() {
-    for(Halfedge* elm : trigs) {
-        delete elm->next->next;
-        delete elm->next;
-        delete elm;
-    }
-    for(Halfedge* elm : bounds) {
-        Halfedge* u(elm->next);
-        while(u != elm) {
-            Halfedge* tmp = u->next;
-            delete u;
-            u = tmp;
-        }
-        delete elm;
-    }
     verts.clear();
     edges.clear();
     trigs.clear();
     bounds.clear();
+    origin.clear();
+    h_twin.clear();
+    h_next.clear();
+    h_vert.clear();
+    h_edge.clear();
+    h_trig.clear();
+    free_halfs.clear();
 }
 
 HalfedgeMesh::HalfedgeMesh(Mesh const& other){
     generate_halfedges(*this,other);
 }
 
-HalfedgeMesh::HalfedgeMesh(HalfedgeMesh const& other) {
-    copy(other);
-}
-HalfedgeMesh& HalfedgeMesh::operator=(HalfedgeMesh const& other) {
-    copy(other);
-    return *this;
+void HalfedgeMesh::copy(HalfedgeMesh const& other) {
+    *this = other;
+    compact();
 }
 
-void HalfedgeMesh::copy(HalfedgeMesh const& other) {
-    cout << "making copy." << endl;
-    vpos = other.vpos;
-    verts = vector<Halfedge*>(other.verts.size(),nullptr);
-    edges = vector<Halfedge*>(other.edges.size(),nullptr);
-    trigs = vector<Halfedge*>(other.trigs.size(),nullptr);
-    for(Halfedge* elm : other.edges) {
-        if(elm->trig == npos) { // if at boundary
-            Halfedge* A = new Halfedge;
-
-            A->vert = elm->vert;
-            A->edge = elm->edge;
-            A->trig = elm->trig;
-            A->twin = A;
-
-            verts[A->vert] = A;
-            edges[A->edge] = A;
-            trigs[A->trig] = A;
-        } else {
-            Halfedge* A = new Halfedge;
-            Halfedge* B = new Halfedge;
-
-            A->vert = elm->vert;
-            A->edge = elm->edge;
-            A->trig = elm->trig;
-            A->twin = B;
-
-            B->vert = elm->twin->vert;
-            B->edge = elm->twin->edge;
-            B->trig = elm->twin->trig;
-            B->twin = A;
-
-            verts[A->vert] = A;
-            edges[A->edge] = A;
-            trigs[A->trig] = A;
-
-            verts[B->vert] = B;
-            edges[B->edge] = B;
-            trigs[B->trig] = B; 
-        }
+Halfedge HalfedgeMesh::new_halfedge() {
+    if(not free_halfs.empty()) {
+        Halfedge h(free_halfs.back());
+        free_halfs.pop_back();
+        return h;
     }
-    for(Halfedge* elm : other.trigs) {
-        size_t trig_ind = elm->trig;
-        Halfedge* A = edges[elm->edge];
-        Halfedge* B = edges[elm->next->edge];
-        Halfedge* C = edges[elm->next->next->edge];
-        if(A->trig != trig_ind) A = A->twin;
-        if(B->trig != trig_ind) B = B->twin;
-        if(C->trig != trig_ind) C = C->twin;
-
-        A->next = B;
-        B->next = C;
-        C->next = A;
+    h_twin.push_back(npos);
+    h_next.push_back(npos);
+    h_vert.push_back(npos);
+    h_edge.push_back(npos);
+    h_trig.push_back(npos);
+    return h_twin.size()-1;
+}
+
+void HalfedgeMesh::delete_halfedge(Halfedge h) {
+    h_twin[h] = npos; // marks h as unused for compact()
+    free_halfs.push_back(h);
+}
+
+void HalfedgeMesh::compact() {
+    if(free_halfs.empty()) return;
+
+    // new index of each halfedge in use
+    vector<Halfedge> new_index(h_twin.size(),npos);
+    size_t n(0);
+    for(size_t h(0);h<h_twin.size();++h) {
+        if(h_twin[h] != npos) new_index[h] = n++;
     }
-    for(Halfedge* elm : other.bounds) {
-        Halfedge* half = edges[elm->edge];
-        if(half->twin->trig == HalfedgeMesh::npos) half = half->twin;
-        bounds.push_back(half);
-
-        Halfedge* start = half->twin;
-        Halfedge* curr = start;
-        Halfedge* curr_before = half;
-        do {
-            curr = curr->next->twin;
-            if(curr->trig == HalfedgeMesh::npos) {
-                curr->next = curr_before;
-                curr_before = curr;
-                curr = curr->twin;
-            } 
-        } while(curr != start);
+
+    for(size_t h(0);h<h_twin.size();++h) {
+        Halfedge k(new_index[h]);
+        if(k == npos) continue;
+        h_twin[k] = new_index[h_twin[h]];
+        h_next[k] = new_index[h_next[h]];
+        h_vert[k] = h_vert[h];
+        h_edge[k] = h_edge[h];
+        h_trig[k] = h_trig[h];
     }
+    h_twin.resize(n);
+    h_next.resize(n);
+    h_vert.resize(n);
+    h_edge.resize(n);
+    h_trig.resize(n);
+    free_halfs.clear();
+
+    for(Halfedge& elm : verts)  elm = new_index[elm];
+    for(Halfedge& elm : trigs)  elm = new_index[elm];
+    for(Halfedge& elm : edges)  elm = new_index[elm];
+    for(Halfedge& elm : bounds) elm = new_index[elm];
 }
 
 HalfedgeMesh generate_halfedges(Mesh const& mesh) {
@@ -132,33 +96,39 @@ void generate_halfedges(HalfedgeMesh& result, Mesh const& mesh) {
     
     // output arrays
     result.vpos = mesh.verts;
-    vector<Halfedge*>& verts = result.verts;
-    verts = vector<Halfedge*>(mesh.verts.size(),nullptr);
-    vector<Halfedge*>& trigs = result.trigs;
+    result.origin.resize(mesh.verts.size());
+    iota(result.origin.begin(),result.origin.end(),0);
+    vector<Halfedge>& verts = result.verts;
+    verts = vector<Halfedge>(mesh.verts.size(),HalfedgeMesh::npos);
+    vector<Halfedge>& trigs = result.trigs;
+    trigs.reserve(mesh.trigs.size());
 
     vector<Tuplet> edges;
-    vector<Halfedge*> edge_halfs;
+    edges.reserve(3*mesh.trigs.size());
+
+    // the three halfedges of triangle i are 3*i, 3*i+1 and 3*i+2, such that
+    // they can be identified with the entries of the edges array
 
     for(size_t i(0);i<mesh.trigs.size();++i) {
         Triplet t(mesh.trigs[i]);
 
-        Halfedge* A = new Halfedge;
-        Halfedge* B = new Halfedge;
-        Halfedge* C = new Halfedge;
+        Halfedge A = result.new_halfedge();
+        Halfedge B = result.new_halfedge();
+        Halfedge C = result.new_halfedge();
 
         // here all relations between faces,vertices and halfedges are created
 
-        A->next = B;
-        A->vert = t.a;
-        A->trig = i;
+        result.next(A) = B;
+        result.vert(A) = t.a;
+        result.trig(A) = i;
 
-        B->next = C;
-        B->vert = t.b;
-        B->trig = i;
+        result.next(B) = C;
+        result.vert(B) = t.b;
+        result.trig(B) = i;
 
-        C->next = A;
-        C->vert = t.c;
-        C->trig = i;
+        result.next(C) = A;
+        result.vert(C) = t.c;
+        result.trig(C) = i;
 
         trigs.push_back(A);
 
@@ -172,10 +142,6 @@ void generate_halfedges(HalfedgeMesh& result, Mesh const& mesh) {
         edges.push_back(Tuplet(t.a,t.b));
         edges.push_back(Tuplet(t.b,t.c));
         edges.push_back(Tuplet(t.c,t.a));
-
-        edge_halfs.push_back(A);
-        edge_halfs.push_back(B);
-        edge_halfs.push_back(C);
     }
 
     size_t K(edges.size());
@@ -183,6 +149,8 @@ void generate_halfedges(HalfedgeMesh& result, Mesh const& mesh) {
     iota(edge_inds.begin(),edge_inds.end(),0);
     sort(edge_inds.begin(),edge_inds.end(),[&edges](size_t a,size_t b) { return edges[a] < edges[b]; });
 
+    result.edges.reserve(K/2+1);
+
     size_t edge_ind(0);
     for(size_t i(0);i<K;++i) {
 
@@ -192,30 +160,26 @@ void generate_halfedges(HalfedgeMesh& result, Mesh const& mesh) {
             // indices are identical. In the other case, the edge was pushed back only
             // once and therefore we have a boundary edge, the case treated here:
 
-            size_t ind  = edge_inds[i];
-            Halfedge* A = edge_halfs[ind];
+            Halfedge A = edge_inds[i];
 
-            A->twin = A;
-            A->edge = edge_ind;
+            result.twin(A) = A;
+            result.edge(A) = edge_ind;
 
             result.edges.push_back(A);
 
         } else {
 
-            size_t ind1 = edge_inds[i];
+            Halfedge A = edge_inds[i];
             i++;
-            size_t ind2 = edge_inds[i];
-
-            Halfedge* A = edge_halfs[ind1];
-            Halfedge* B = edge_halfs[ind2];
+            Halfedge B = edge_inds[i];
 
             // now we can add the final informations to the halfedges
 
-            A->twin = B;
-            B->twin = A;
+            result.twin(A) = B;
+            result.twin(B) = A;
 
-            A->edge = edge_ind;
-            B->edge = edge_ind;
+            result.edge(A) = edge_ind;
+            result.edge(B) = edge_ind;
 
             result.edges.push_back(A);
         }
@@ -224,27 +188,25 @@ void generate_halfedges(HalfedgeMesh& result, Mesh const& mesh) {
 
     }
 
-    for(Halfedge* u : result.verts) {
-        Halfedge* start(u);
-        Halfedge* first_boundary(nullptr);
-        Halfedge* last_boundary(nullptr);
+    for(Halfedge u : result.verts) {
+        Halfedge start(u);
+        Halfedge first_boundary(HalfedgeMesh::npos);
+        Halfedge last_boundary(HalfedgeMesh::npos);
 
-        //size_t k(0);
         do {
-            if(u == u->twin) { // handle boundary edges! (add corresponding halfedges)
-                //cout << "  > edge-piece nr. " << k++ << endl;
-                Halfedge* B = new Halfedge;
-                B->twin = u;
-                B->trig = HalfedgeMesh::npos;
-                B->next = last_boundary;
-                B->edge = u->edge;
-                B->vert = u->next->vert;
-
-                u->twin = B;
-                u = u->next;
+            if(u == result.twin(u)) { // handle boundary edges! (add corresponding halfedges)
+                Halfedge B = result.new_halfedge();
+                result.twin(B) = u;
+                result.trig(B) = HalfedgeMesh::npos;
+                result.next(B) = last_boundary;
+                result.edge(B) = result.edge(u);
+                result.vert(B) = result.vert(result.next(u));
+
+                result.twin(u) = B;
+                u = result.next(u);
 
                 last_boundary = B;
-                if(first_boundary == nullptr) {
+                if(first_boundary == HalfedgeMesh::npos) {
                     first_boundary = B;
                     // since this part of the code is called once for each boundary,
                     // we can append now an element to the bounds array
@@ -252,11 +214,11 @@ void generate_halfedges(HalfedgeMesh& result, Mesh const& mesh) {
                 } 
 
             } else {
-                u = u->twin->next;
+                u = result.next(result.twin(u));
             }
         } while(u != start);
-        if(first_boundary != nullptr) {
-            first_boundary->next = last_boundary;
+        if(first_boundary != HalfedgeMesh::npos) {
+            result.next(first_boundary) = last_boundary;
         }
     }
 }
@@ -270,17 +232,18 @@ Mesh generate_mesh(HalfedgeMesh const& mesh) {
 void generate_mesh(Mesh& result, HalfedgeMesh const& mesh) {
     result.clear();
     result.verts = mesh.vpos;
-    for(Halfedge* elm : mesh.trigs) {
-        Triplet t(elm->vert,elm->next->vert,elm->next->next->vert);
+    result.trigs.reserve(mesh.trigs.size());
+    for(Halfedge elm : mesh.trigs) {
+        Triplet t(mesh.vert(elm),mesh.vert(mesh.next(elm)),mesh.vert(mesh.next(mesh.next(elm))));
         result.trigs.push_back(t);
     }
 }
 
-bool at_boundary_u(Halfedge* vert) {
-    Halfedge* u(vert);
+bool at_boundary_u(HalfedgeMesh const& mesh, Halfedge vert) {
+    Halfedge u(vert);
     do {
-        if(u->trig == HalfedgeMesh::npos or u->twin->trig == HalfedgeMesh::npos) return true;
-        u = u->twin->next;
+        if(mesh.trig(u) == HalfedgeMesh::npos or mesh.trig(mesh.twin(u)) == HalfedgeMesh::npos) return true;
+        u = mesh.next(mesh.twin(u));
     } while(u != vert);
     return false;
 }
@@ -300,61 +263,54 @@ bool HalfedgeMesh::check_validity() const {
     size_t error_vertind(0);
     size_t error_valence(0);
 
-    //cout << "a" << endl;
-
-    for(Halfedge* elm : trigs) {
-        if(elm->next->next->next != elm) error_nnn++;           // check that next-pointers connect correctly
-        if(elm->next->trig != elm->trig) error_trigind++;       // check that halfedges point to same triangle
-        if(elm->next->next->trig != elm->trig) error_trigind++; // -^
+    for(Halfedge elm : trigs) {
+        if(next(next(next(elm))) != elm) error_nnn++;             // check that next-pointers connect correctly
+        if(trig(next(elm)) != trig(elm)) error_trigind++;         // check that halfedges point to same triangle
+        if(trig(next(next(elm))) != trig(elm)) error_trigind++;   // -^
     }
-    //cout << "b" << endl;
-    for(Halfedge* elm : edges) {
-        if(elm->twin->twin != elm) error_tt++;                  // check that twin of twin is element itself
-        if(edges[elm->edge] != elm) error_edgeind++;       // check that edge indices are correct
-        if(edges[elm->twin->edge] != elm) error_edgeind++; // check that edge indices are correct
+    for(Halfedge elm : edges) {
+        if(twin(twin(elm)) != elm) error_tt++;                    // check that twin of twin is element itself
+        if(edges[edge(elm)] != elm) error_edgeind++;              // check that edge indices are correct
+        if(edges[edge(twin(elm))] != elm) error_edgeind++;        // check that edge indices are correct
     }
-    //cout << "c" << endl;
 
 
     // the following 18 lines are for checking that the valence number computed by two different methods are consistent
     vector<size_t> valences(verts.size(),0);
 
-    for(Halfedge* elm : trigs) {
-        valences[elm->vert]++;
-        valences[elm->next->vert]++;
-        valences[elm->next->next->vert]++;
+    for(Halfedge elm : trigs) {
+        valences[vert(elm)]++;
+        valences[vert(next(elm))]++;
+        valences[vert(next(next(elm)))]++;
     }
-    //cout << "d" << endl;
 
     // add one for all vertices at boundaries
-    for(Halfedge* elm : bounds) {
-        Halfedge* u(elm);
+    for(Halfedge elm : bounds) {
+        Halfedge u(elm);
         do {
-            valences[u->vert]++;
-            u = u->next; // slide along boundary
+            valences[vert(u)]++;
+            u = next(u); // slide along boundary
         } while(u != elm);
     }
-    //cout << "e" << endl;
 
     size_t i(0);
-    for(Halfedge* elm : verts) {
+    for(Halfedge elm : verts) {
         i++;
-        Halfedge* u(elm);
+        Halfedge u(elm);
         size_t valence = 0;
         do {
             valence++;
-            if(u->vert != elm->vert) {
+            if(vert(u) != vert(elm)) {
                 error_vertind++;
-                if(at_boundary_u(verts[u->vert])) cout << "boundary: " << i << "/" << verts.size() << endl;
+                if(at_boundary_u(*this,verts[vert(u)])) cout << "boundary: " << i << "/" << verts.size() << endl;
             } 
-            u = u->twin->next;
+            u = next(twin(u));
         } while(u != elm);
-        if(valence != valences[elm->vert]){
+        if(valence != valences[vert(elm)]){
             error_valence++; 
-            cout << valence << " -%- " << valences[elm->vert] << endl;
+            cout << valence << " -%- " << valences[vert(elm)] << endl;
         } 
     }
-    //cout << "f" << endl;
 
 
 //#ifdef VERBOSE
@@ -382,15 +338,15 @@ vector<vec3> generate_vertex_normals(HalfedgeMesh const& mesh) {
 
     for(size_t i(0);i<n;++i) {
         vec3 normal;
-        Halfedge* u(mesh.verts[i]);
-        Halfedge* v(u);
+        Halfedge u(mesh.verts[i]);
+        Halfedge v(u);
         do {
-            vec3 B(mesh.vpos[u->next->vert]-mesh.vpos[u->vert]);
-            vec3 C(mesh.vpos[u->next->next->vert]-mesh.vpos[u->vert]);
+            vec3 B(mesh.vpos[mesh.vert(mesh.next(u))]-mesh.vpos[mesh.vert(u)]);
+            vec3 C(mesh.vpos[mesh.vert(mesh.next(mesh.next(u)))]-mesh.vpos[mesh.vert(u)]);
             normal += B.vec(C)*(1.0/(B.norm2()*C.norm2()));
 
 
-            u = u->twin->next;
+            u = mesh.next(mesh.twin(u));
         } while(u != v);
         normal.normalize();
         vertex_normals.push_back(normal);
@@ -399,4 +355,4 @@ vector<vec3> generate_vertex_normals(HalfedgeMesh const& mesh) {
 }
 
 
-} // namespace Bem
\ No newline at end of file
+} // namespace Bem
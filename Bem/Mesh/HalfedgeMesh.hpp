@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <vector>
+#include <cstdint>
 
 #include "Mesh.hpp"
 
@@ -12,43 +13,73 @@ namespace Bem {
 // Each edge has two Halfedges that point in oposite directions. A halfedge points always from one
 // vertex to the other and it has a pointer to its twin, to the next halfedge (rooting at the vertex
 // it points to) of the same triangle, to a vertex (where its root is), to its edge and its triangle.
-// To form a complete structure, the vertices, edges and triangles each have to have a pointer to one 
+// To form a complete structure, the vertices, edges and triangles each have to have a pointer to one
 // Halfedge they're connected with too. Although it isn't important which exact Halfedge they point to.
-// This structure is quite a bit more complicated, but it allows to jump easily from one neighbour of 
+// This structure is quite a bit more complicated, but it allows to jump easily from one neighbour of
 // vertices/edges/triangles to another without the need to ever loop over all elements. Most applications
-// of this structure are presented in MeshManip.hpp/.cpp. In HalfedgeMesh.cpp we define the functions 
+// of this structure are presented in MeshManip.hpp/.cpp. In HalfedgeMesh.cpp we define the functions
 // needed to translate between the Mesh and HalfedgeMesh representations.
+//
+// The halfedges are stored in the mesh itself, as a structure of arrays: a Halfedge is the (32 bit)
+// index of a halfedge and its "pointers" are read and written with mesh.twin(h), mesh.next(h),
+// mesh.vert(h), mesh.edge(h) and mesh.trig(h). Removed halfedges are put on a free list and reused
+// by new_halfedge, such that the remeshing functions don't allocate memory for every element they
+// create. compact() removes the holes left by removed halfedges (a copy of the mesh is compact).
 
-struct Halfedge {
-    Halfedge* twin;
-    Halfedge* next;
-    size_t vert;
-    size_t edge;
-    size_t trig;
-};
+typedef uint32_t Halfedge;
 
 struct HalfedgeMesh {
-    std::vector<vec3>      vpos;
-    std::vector<Halfedge*> verts;
-    std::vector<Halfedge*> trigs;
-    std::vector<Halfedge*> edges;
-    std::vector<Halfedge*> bounds;
-
-    ~HalfedgeMesh();
+    std::vector<vec3>     vpos;
+    std::vector<Halfedge> verts;
+    std::vector<Halfedge> trigs;
+    std::vector<Halfedge> edges;
+    std::vector<Halfedge> bounds;
+    // for each vertex, the vertex of the Mesh it was generated from (generate_halfedges) resp. the
+    // origin of the vertices it was split from or merged into (split_edges, collapse_edges)
+    std::vector<size_t>   origin;
 
     void clear();
     bool check_validity() const;
-    
+
     HalfedgeMesh(Mesh const& other);
-    HalfedgeMesh(HalfedgeMesh&&) = default;
     HalfedgeMesh() = default;
-    HalfedgeMesh(HalfedgeMesh const& other);
-    HalfedgeMesh& operator=(HalfedgeMesh const& other);
-    HalfedgeMesh& operator=(HalfedgeMesh&&) = default; // check this!
-    
+
     void copy(HalfedgeMesh const& other);
 
-    static const size_t npos;
+    // access to the connectivity of halfedge h
+    Halfedge& twin(Halfedge h) { return h_twin[h]; }
+    Halfedge& next(Halfedge h) { return h_next[h]; }
+    uint32_t& vert(Halfedge h) { return h_vert[h]; }
+    uint32_t& edge(Halfedge h) { return h_edge[h]; }
+    uint32_t& trig(Halfedge h) { return h_trig[h]; }
+    Halfedge twin(Halfedge h) const { return h_twin[h]; }
+    Halfedge next(Halfedge h) const { return h_next[h]; }
+    uint32_t vert(Halfedge h) const { return h_vert[h]; }
+    uint32_t edge(Halfedge h) const { return h_edge[h]; }
+    uint32_t trig(Halfedge h) const { return h_trig[h]; }
+
+    // returns a new (uninitialized) halfedge, taken from the free list if possible
+    Halfedge new_halfedge();
+    // puts halfedge h on the free list
+    void delete_halfedge(Halfedge h);
+
+    // number of halfedges in use resp. reserved (including the ones on the free list)
+    size_t num_halfedges() const { return h_twin.size() - free_halfs.size(); }
+    size_t halfedge_capacity() const { return h_twin.size(); }
+
+    // renumbers the halfedges in use such that they are stored without holes (keeping their order)
+    void compact();
+
+    static const uint32_t npos;
+
+private:
+    std::vector<Halfedge> h_twin;
+    std::vector<Halfedge> h_next;
+    std::vector<uint32_t> h_vert;
+    std::vector<uint32_t> h_edge;
+    std::vector<uint32_t> h_trig;
+
+    std::vector<Halfedge> free_halfs;
 };
 
 HalfedgeMesh generate_halfedges(Mesh const& mesh);
@@ -60,4 +91,4 @@ std::vector<vec3> generate_vertex_normals(HalfedgeMesh const& mesh);
 
 } // namespace Bem
 
-#endif // HALFEDGEMESH_HPP
\ No newline at end of file
+#endif // HALFEDGEMESH_HPP
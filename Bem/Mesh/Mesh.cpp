@@ -1,6 +1,10 @@
 #include "Mesh.hpp"
 
 #include <set>
+#include <atomic>
+#include <algorithm>
+#include <limits>
+#include <omp.h>
 #include <Eigen/Dense> // for curvature computation
 #include "FittingTool.hpp" // for CoordSystem
 
@@ -20,6 +24,7 @@ void Mesh::add(Mesh other,vec3 const& position) {
         t.c += n_old;
         trigs.push_back(t);
     }
+    connectivity_changed();
 }
 void Mesh::scale(real s) {
     for(vec3& elm : verts)
@@ -53,6 +58,7 @@ void Mesh::translate(vec3 v) {
 void Mesh::clear() {
     verts.clear();
     trigs.clear();
+    topology.reset();
 }
 
 bool Mesh::check_validity() const {
@@ -72,59 +78,178 @@ bool Mesh::check_validity() const {
     return result;
 }
 
-vector<vector<size_t>> generate_triangle_indices(Mesh const& mesh) {
-    vector<vector<size_t>> triangle_indices(mesh.verts.size());
-    size_t m(mesh.trigs.size());
-    for(size_t i(0);i<m;++i){
-        triangle_indices[mesh.trigs[i].a].push_back(i);
-        triangle_indices[mesh.trigs[i].b].push_back(i);
-        triangle_indices[mesh.trigs[i].c].push_back(i);
+// the versions are unique, such that a topology never fits a mesh whose connectivity was changed
+static atomic<size_t> connectivity_version(0);
+
+void Mesh::connectivity_changed() {
+    version = ++connectivity_version;
+    topology.reset();
+}
+
+void Mesh::copy_connectivity(Mesh const& other) {
+    trigs = other.trigs;
+    version = other.version;
+    topology = atomic_load(&other.topology);
+}
+
+static vector<Mesh> split_connectivity(Mesh const& mesh, Adjacency const& neighbours, Adjacency const& trig_indices, vector<vector<size_t>>& vert_perm);
+
+// The topology is attached with atomic operations, such that threads sharing a mesh may call this
+// function concurrently (at worst, the topology is built more than once). The check is O(1): changes
+// of the triangles in place have to be announced with Mesh::connectivity_changed.
+shared_ptr<const MeshTopology> get_topology(Mesh const& mesh) {
+    shared_ptr<const MeshTopology> topo = atomic_load(&mesh.topology);
+    if(topo and topo->version == mesh.version and topo->num_verts == mesh.verts.size() and topo->num_trigs == mesh.trigs.size())
+        return topo;
+
+    shared_ptr<MeshTopology> result = make_shared<MeshTopology>();
+    result->version = mesh.version;
+    result->num_verts = mesh.verts.size();
+    result->num_trigs = mesh.trigs.size();
+    result->triangle_indices = generate_triangle_indices(mesh);
+    result->neighbours = generate_neighbours(mesh,result->triangle_indices);
+    result->two_ring = generate_2_ring(mesh,result->neighbours);
+
+    topo = result;
+    atomic_store(&mesh.topology,topo);
+    return topo;
+}
+
+// the same for the loose parts, which only a few callers need (attached to the topology)
+shared_ptr<const LooseParts> get_loose_parts(Mesh const& mesh) {
+    shared_ptr<const MeshTopology> topo(get_topology(mesh));
+    shared_ptr<const LooseParts> parts = atomic_load(&topo->loose_parts);
+    if(parts) return parts;
+
+    shared_ptr<LooseParts> result = make_shared<LooseParts>();
+    result->parts = split_connectivity(mesh,topo->neighbours,topo->triangle_indices,result->part_verts);
+    for(Mesh& part : result->parts) {
+        get_topology(part);
+        part.verts.clear();
     }
-    return triangle_indices;
+
+    parts = result;
+    atomic_store(&topo->loose_parts,parts);
+    return parts;
+}
+
+// builds the lists of n vertices: list(i,out) appends the entries of vertex i to out. Each thread
+// handles a contiguous range of vertices (static schedule) and writes to its own buffer, the buffers
+// are concatenated in the order of the threads, such that the result doesn't depend on their number.
+template<typename list_t>
+static Adjacency build_adjacency(size_t n,list_t const& list) {
+    Adjacency adj;
+    adj.offset.assign(n+1,0);
+    vector<vector<uint32_t>> buffers;
+
+    #pragma omp parallel if(n >= 4096)
+    {
+        #pragma omp single
+        buffers.resize(omp_get_num_threads());
+
+        vector<uint32_t>& buffer(buffers[omp_get_thread_num()]);
+        #pragma omp for schedule(static)
+        for(size_t i = 0;i<n;++i) {
+            size_t before(buffer.size());
+            list(i,buffer);
+            adj.offset[i+1] = buffer.size() - before;
+        }
+    }
+
+    for(size_t i(0);i<n;++i)
+        adj.offset[i+1] += adj.offset[i];
+    adj.index.reserve(adj.offset[n]);
+    for(vector<uint32_t> const& buffer : buffers)
+        adj.index.insert(adj.index.end(),buffer.begin(),buffer.end());
+
+    return adj;
 }
 
-vector<vector<size_t>> generate_2_ring(Mesh const& mesh, vector<vector<size_t>> const& neighbours) {
-    vector<vector<size_t>> ring;
+// sorts the entries appended to list after position begin and removes the duplicates
+static void sort_unique(vector<uint32_t>& list,size_t begin) {
+    sort(list.begin()+begin,list.end());
+    list.erase(unique(list.begin()+begin,list.end()),list.end());
+}
 
+// counting sort of the triangles by their vertices (sequential, keeps the triangles in ascending order)
+Adjacency generate_triangle_indices(Mesh const& mesh) {
     size_t n(mesh.verts.size());
-    for(size_t i(0);i<n;++i) {
-        set<size_t> second_ring_indices;
-        for(size_t k : neighbours[i]) {
-            for(size_t l : neighbours[k]) {
-                second_ring_indices.insert(l);
-            }
-        }
+    size_t m(mesh.trigs.size());
+    assert(n < numeric_limits<uint32_t>::max() and m < numeric_limits<uint32_t>::max());
+
+    Adjacency triangle_indices;
+    triangle_indices.offset.assign(n+1,0);
+    for(Triplet const& t : mesh.trigs) {
+        triangle_indices.offset[t.a+1]++;
+        triangle_indices.offset[t.b+1]++;
+        triangle_indices.offset[t.c+1]++;
+    }
+    for(size_t i(0);i<n;++i)
+        triangle_indices.offset[i+1] += triangle_indices.offset[i];
 
-        ring.push_back(vector<size_t>(second_ring_indices.begin(),second_ring_indices.end()));
+    triangle_indices.index.resize(3*m);
+    vector<uint32_t> pos(triangle_indices.offset.begin(),triangle_indices.offset.end()-1);
+    for(size_t i(0);i<m;++i) {
+        triangle_indices.index[pos[mesh.trigs[i].a]++] = i;
+        triangle_indices.index[pos[mesh.trigs[i].b]++] = i;
+        triangle_indices.index[pos[mesh.trigs[i].c]++] = i;
     }
+    return triangle_indices;
+}
 
-    return ring;
+Adjacency generate_2_ring(Mesh const& mesh, Adjacency const& neighbours) {
+    return build_adjacency(mesh.verts.size(),[&](size_t i,vector<uint32_t>& list) {
+        size_t begin(list.size());
+        for(size_t k : neighbours[i])
+            list.insert(list.end(),neighbours[k].begin(),neighbours[k].end());
+        sort_unique(list,begin);
+    });
 }
 
-vector<vector<size_t>> generate_2_ring(Mesh const& mesh) {
+Adjacency generate_2_ring(Mesh const& mesh) {
     return generate_2_ring(mesh,generate_neighbours(mesh));
 }
 
-vector<vector<size_t>> generate_neighbours(Mesh const& mesh) {
-    size_t n(mesh.verts.size());
-    vector<set<size_t>> neighbours(n);
-    vector<vector<size_t>> result;
-    for(Triplet t : mesh.trigs){
-        neighbours[t.a].insert(t.b);
-        neighbours[t.a].insert(t.c);
-
-        neighbours[t.b].insert(t.c);
-        neighbours[t.b].insert(t.a);
+vector<vector<size_t>> color_triangles(Mesh const& mesh) {
+    shared_ptr<const MeshTopology> topo(get_topology(mesh));
+    Adjacency const& triangle_indices(topo->triangle_indices);
+    size_t m(mesh.trigs.size());
+    vector<size_t> color(m,m); // m means: not yet colored
+    vector<vector<size_t>> groups;
+    vector<bool> used;
 
-        neighbours[t.c].insert(t.a);
-        neighbours[t.c].insert(t.b);
-    }
-    // copy the indices in the set into a vector array for convenience
-    for(size_t i(0);i<n;++i) {
-        result.push_back(vector<size_t>(neighbours[i].begin(),neighbours[i].end()));
+    for(size_t i(0);i<m;++i) {
+        used.assign(groups.size()+1,false);
+        for(size_t k(0);k<3;++k) {
+            for(size_t j : triangle_indices[mesh.trigs[i][k]]) {
+                if(color[j] < m) used[color[j]] = true;
+            }
+        }
+        size_t c(0);
+        while(used[c]) ++c;
+        if(c == groups.size()) groups.push_back(vector<size_t>());
+        color[i] = c;
+        groups[c].push_back(i);
     }
 
-    return result;
+    return groups;
+}
+
+Adjacency generate_neighbours(Mesh const& mesh, Adjacency const& triangle_indices) {
+    return build_adjacency(mesh.verts.size(),[&](size_t i,vector<uint32_t>& list) {
+        size_t begin(list.size());
+        for(size_t j : triangle_indices[i]) {
+            Triplet t(mesh.trigs[j]);
+            for(size_t k(0);k<3;++k) {
+                if(t[k] != i) list.push_back(t[k]);
+            }
+        }
+        sort_unique(list,begin);
+    });
+}
+
+Adjacency generate_neighbours(Mesh const& mesh) {
+    return generate_neighbours(mesh,generate_triangle_indices(mesh));
 }
 
 vector<vec3> generate_triangle_normals  (Mesh const& mesh) {
@@ -138,7 +263,7 @@ vector<vec3> generate_triangle_normals  (Mesh const& mesh) {
 }
 
 // approximation of vertex normals as proposed by Max_1999 (see Rusinkiewicz_2004). Is exact for vertices on a sphere
-vector<vec3> generate_vertex_normals(Mesh const& mesh, vector<vector<size_t>> const& triangle_indices) {
+vector<vec3> generate_vertex_normals(Mesh const& mesh, Adjacency const& triangle_indices) {
     vector<vec3> vertex_normals;
 
     size_t n(mesh.verts.size());
@@ -159,11 +284,11 @@ vector<vec3> generate_vertex_normals(Mesh const& mesh, vector<vector<size_t>> co
 }
 
 vector<vec3> generate_vertex_normals(Mesh const& mesh) {
-    return generate_vertex_normals(mesh,generate_triangle_indices(mesh));
+    return generate_vertex_normals(mesh,get_topology(mesh)->triangle_indices);
 }
 
 // solid angle computation using spherical trigonometry (rule in the last line of this function, see Todhunter_1886)
-real solid_angle_at_vertex(Mesh const& mesh, vector<vector<size_t>> const& triangle_indices, vector<vec3> const& triangle_normals, size_t i) {
+real solid_angle_at_vertex(Mesh const& mesh, Adjacency const& triangle_indices, vector<vec3> const& triangle_normals, size_t i) {
     vector<Triplet> trigs;
     for(size_t j : triangle_indices[i]){
         Triplet trig(mesh.trigs[j]);
@@ -200,7 +325,7 @@ real solid_angle_at_vertex(Mesh const& mesh, vector<vector<size_t>> const& trian
 }
 
 real solid_angle_at_vertex(Mesh const& mesh, size_t i) {
-    return solid_angle_at_vertex(mesh,generate_triangle_indices(mesh),generate_triangle_normals(mesh),i);
+    return solid_angle_at_vertex(mesh,get_topology(mesh)->triangle_indices,generate_triangle_normals(mesh),i);
 }
 
 real volume(Mesh const& mesh) {
@@ -361,7 +486,7 @@ Mesh join_meshes(vector<Mesh> const& list) {
     return joined;
 }
 
-void update_connected(set<size_t>& connected,set<size_t>& front,vector<vector<size_t>> const& neighbours) {
+void update_connected(set<size_t>& connected,set<size_t>& front,Adjacency const& neighbours) {
     set<size_t> new_front;
     for(size_t elm : front) {
         for(size_t candidate : neighbours[elm]) {
@@ -378,13 +503,27 @@ vector<Mesh> split_by_loose_parts(Mesh const& mesh) {
 
 // split_by_loose_parts scans the mesh for parts that are not connected with each other.
 // In our case we want to split up the mesh describing a group of bubbles into a vector
-// of meshes describing each only one bubble.
+// of meshes describing each only one bubble. The parts are taken from get_loose_parts,
+// only their vertices are copied.
 vector<Mesh> split_by_loose_parts(Mesh const& mesh, vector<vector<size_t>>& vert_perm) {
+    shared_ptr<const LooseParts> loose(get_loose_parts(mesh));
+
+    vector<Mesh> result(loose->parts);
+    for(size_t k(0);k<result.size();++k) {
+        vector<size_t> const& inds(loose->part_verts[k]);
+        result[k].verts.resize(inds.size());
+        for(size_t i(0);i<inds.size();++i)
+            result[k].verts[i] = mesh.verts[inds[i]];
+        vert_perm.push_back(inds);
+    }
+    return result;
+}
+
+// the loose parts of the mesh, done from scratch
+static vector<Mesh> split_connectivity(Mesh const& mesh, Adjacency const& neighbours, Adjacency const& trig_indices, vector<vector<size_t>>& vert_perm) {
     vector<Mesh> result;
 
     Mesh temp = mesh;
-    vector<vector<size_t>> neighbours = generate_neighbours(temp);
-    vector<vector<size_t>> trig_indices = generate_triangle_indices(temp);
     vector<bool> processed(temp.verts.size(),false);
 
     while(true) {
@@ -3,12 +3,44 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <cstdint>
 #include <cassert>
 
 #include "../basic/Bem.hpp"
 
 namespace Bem {
 
+struct MeshTopology;
+struct LooseParts;
+
+// Adjacency lists of the vertices of a mesh in compressed form (CSR): the entries of vertex i are
+// index[offset[i]],...,index[offset[i+1]-1]. adj[i] returns them as a range, such that the lists can be
+// traversed as before with for(size_t j : adj[i]).
+struct Adjacency {
+    struct Row {
+        uint32_t const* first;
+        uint32_t const* last;
+
+        uint32_t const* begin() const { return first; }
+        uint32_t const* end() const { return last; }
+        size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+        size_t operator[](size_t k) const { return first[k]; }
+    };
+
+    std::vector<uint32_t> offset;
+    std::vector<uint32_t> index;
+
+    size_t size() const {
+        return offset.empty() ? 0 : offset.size() - 1;
+    }
+
+    Row operator[](size_t i) const {
+        return Row{index.data() + offset[i],index.data() + offset[i+1]};
+    }
+};
+
 // the mesh class consists of a vector of vertices and a vector triangle indices.
 // additionaly there are some very basic class methods.
 
@@ -25,25 +57,73 @@ struct Mesh {
     void clear();
 
     bool check_validity() const;
+
+    // has to be called after changing trigs (or the numbering of the vertices) in place: gives the mesh a
+    // new connectivity version, such that get_topology rebuilds the topology. Meshes created from
+    // scratch (e.g. by generate_mesh after remeshing) don't need it.
+    void connectivity_changed();
+    // copies the triangles of other together with its connectivity version and topology
+    void copy_connectivity(Mesh const& other);
+
+    // version of the connectivity (see connectivity_changed) and the data derived from it, built by
+    // get_topology (shared by the copies of the mesh)
+    size_t version = 0;
+    mutable std::shared_ptr<const MeshTopology> topology;
 };
 
-// generate_triangle_indices returns for each vertex a vector of indices 
-// of the triangles touching this vertex. The outer vector's length is thus
+// The MeshTopology holds the data which only depends on the connectivity of a mesh, i.e. on its triangles
+// and number of vertices. get_topology builds it once and attaches it to the mesh: moving the vertices
+// doesn't invalidate it, only a new connectivity version (Mesh::connectivity_changed) or a different
+// number of vertices or triangles. Geometric quantities (normals, areas, curvatures) are always recomputed.
+struct MeshTopology {
+    size_t version;              // the connectivity the data belongs to
+    size_t num_verts;
+    size_t num_trigs;
+
+    Adjacency triangle_indices;  // see generate_triangle_indices
+    Adjacency neighbours;        // see generate_neighbours
+    Adjacency two_ring;          // see generate_2_ring
+
+    // built by get_loose_parts on first use
+    mutable std::shared_ptr<const LooseParts> loose_parts;
+};
+
+// loose parts of a mesh (see split_by_loose_parts): their vertices (vert_perm) and triangles (with their
+// own topology attached, the vertices are left empty)
+struct LooseParts {
+    std::vector<std::vector<size_t>> part_verts;
+    std::vector<Mesh> parts;
+};
+
+// returns the topology of mesh, which is only built if the connectivity of mesh changed since the last call
+std::shared_ptr<const MeshTopology> get_topology(Mesh const& mesh);
+// returns the loose parts of mesh, which are built with the first call for its topology
+std::shared_ptr<const LooseParts> get_loose_parts(Mesh const& mesh);
+
+// The following functions build the adjacency data from scratch (the lists of large meshes in parallel),
+// get_topology(mesh) returns the cached results for the given connectivity. All lists are sorted.
+// generate_triangle_indices returns for each vertex the indices 
+// of the triangles touching this vertex. The number of lists is thus
 // the same as mesh.verts.size()
-std::vector<std::vector<size_t>> generate_triangle_indices(Mesh const& mesh);
+Adjacency generate_triangle_indices(Mesh const& mesh);
 // generate_neighbours returns for each vertex a list of its direct neighbours (connected with an edge)
-std::vector<std::vector<size_t>> generate_neighbours(Mesh const& mesh);
+Adjacency generate_neighbours(Mesh const& mesh);
+Adjacency generate_neighbours(Mesh const& mesh, Adjacency const& triangle_indices);
 // generate_2_ring returns for each vertex a list of the neighbours of its neighbours, including the vertex itself
-std::vector<std::vector<size_t>> generate_2_ring(Mesh const& mesh);
-std::vector<std::vector<size_t>> generate_2_ring(Mesh const& mesh, std::vector<std::vector<size_t>> const& neighbours);
+Adjacency generate_2_ring(Mesh const& mesh);
+Adjacency generate_2_ring(Mesh const& mesh, Adjacency const& neighbours);
+// color_triangles partitions the triangles into groups (colors) of triangles which do not share any vertex
+// (greedy coloring in the order of the triangles). Triangles of the same color can thus write to the rows or
+// columns of their vertices in parallel without conflicts.
+std::vector<std::vector<size_t>> color_triangles(Mesh const& mesh);
 
 std::vector<vec3> generate_triangle_normals  (Mesh const& mesh); // with vector product
 // vertex normals according to Max_1999
-std::vector<vec3> generate_vertex_normals    (Mesh const& mesh, std::vector<std::vector<size_t>> const& triangle_indices);
+std::vector<vec3> generate_vertex_normals    (Mesh const& mesh, Adjacency const& triangle_indices);
 std::vector<vec3> generate_vertex_normals    (Mesh const& mesh);
 
 // solid angle of mesh w.r.t. vertex i
-real solid_angle_at_vertex(Mesh const& mesh, std::vector<std::vector<size_t>> const& triangle_indices, std::vector<vec3>& triangle_normals, size_t i); 
+real solid_angle_at_vertex(Mesh const& mesh, Adjacency const& triangle_indices, std::vector<vec3>& triangle_normals, size_t i); 
 real solid_angle_at_vertex(Mesh const& mesh, size_t i);
 
 real volume(Mesh const& mesh);          // computes total volume of the mesh
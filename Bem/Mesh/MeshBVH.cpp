@@ -0,0 +1,305 @@
+#include "MeshBVH.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cmath>
+#include <cassert>
+
+using namespace std;
+
+namespace Bem {
+
+namespace {
+
+// k-th component of v
+inline real coord(vec3 const& v,int k) {
+    return k == 0 ? v.x : (k == 1 ? v.y : v.z);
+}
+
+inline vec3 min3(vec3 const& a,vec3 const& b) {
+    return vec3(min(a.x,b.x),min(a.y,b.y),min(a.z,b.z));
+}
+
+inline vec3 max3(vec3 const& a,vec3 const& b) {
+    return vec3(max(a.x,b.x),max(a.y,b.y),max(a.z,b.z));
+}
+
+inline real area(vec3 const& lo,vec3 const& hi) {
+    vec3 e(hi-lo);
+    return 2.0*(e.x*e.y + e.y*e.z + e.z*e.x);
+}
+
+const size_t num_bins = 16;
+const size_t max_sah_depth = 32; // below this depth the nodes are split at the median (bounds the depth)
+const size_t stack_size = 128;
+
+} // namespace
+
+MeshBVH::MeshBVH(Mesh const& mesh,size_t leaf_size) {
+    size_t m(mesh.trigs.size());
+    if(m == 0) return;
+
+    order.resize(m);
+    iota(order.begin(),order.end(),0);
+
+    nodes.push_back(Node{vec3(),vec3(),0,uint32_t(m),0});
+
+    // bounding boxes and centroids of the triangles
+    vector<vec3> t_lo(m), t_hi(m), centroid(m);
+    for(size_t j(0);j<m;++j) {
+        Triplet t(mesh.trigs[j]);
+        vec3 const& A(mesh.verts[t.a]);
+        vec3 const& B(mesh.verts[t.b]);
+        vec3 const& C(mesh.verts[t.c]);
+        t_lo[j] = min3(A,min3(B,C));
+        t_hi[j] = max3(A,max3(B,C));
+        centroid[j] = (1.0/3.0)*(A+B+C);
+    }
+
+    // nodes to be split (index, depth)
+    vector<pair<size_t,size_t>> todo = {{0,0}};
+
+    while(not todo.empty()) {
+        size_t n(todo.back().first), depth(todo.back().second);
+        todo.pop_back();
+
+        size_t begin(nodes[n].begin), end(nodes[n].end);
+
+        vec3 lo(t_lo[order[begin]]), hi(t_hi[order[begin]]);
+        vec3 c_lo(centroid[order[begin]]), c_hi(c_lo);
+        for(size_t i(begin+1);i<end;++i) {
+            lo   = min3(lo,t_lo[order[i]]);
+            hi   = max3(hi,t_hi[order[i]]);
+            c_lo = min3(c_lo,centroid[order[i]]);
+            c_hi = max3(c_hi,centroid[order[i]]);
+        }
+        nodes[n].lo = lo;
+        nodes[n].hi = hi;
+
+        size_t count(end-begin);
+        if(count <= leaf_size) continue;
+
+        // binned surface area heuristic: cost of a split is n_left*area_left + n_right*area_right
+        real best_cost(numeric_limits<real>::max());
+        int best_axis(-1);
+        size_t best_bin(0);
+
+        if(depth < max_sah_depth) {
+            for(int k(0);k<3;++k) {
+                real c_0(coord(c_lo,k)), c_1(coord(c_hi,k));
+                if(not (c_1 > c_0)) continue;
+                real scale(num_bins/(c_1-c_0));
+
+                size_t bin_count[num_bins] = {};
+                vec3 bin_lo[num_bins], bin_hi[num_bins];
+                for(size_t i(begin);i<end;++i) {
+                    size_t j(order[i]);
+                    size_t b(min(num_bins-1,size_t((coord(centroid[j],k)-c_0)*scale)));
+                    if(bin_count[b] == 0) {
+                        bin_lo[b] = t_lo[j];
+                        bin_hi[b] = t_hi[j];
+                    } else {
+                        bin_lo[b] = min3(bin_lo[b],t_lo[j]);
+                        bin_hi[b] = max3(bin_hi[b],t_hi[j]);
+                    }
+                    bin_count[b]++;
+                }
+
+                // sweep from the right for the areas of the right sides
+                real right_area[num_bins];
+                size_t right_count[num_bins];
+                size_t num(0);
+                vec3 r_lo, r_hi;
+                for(size_t b(num_bins);b-->1;) {
+                    if(bin_count[b] > 0) {
+                        r_lo = num == 0 ? bin_lo[b] : min3(r_lo,bin_lo[b]);
+                        r_hi = num == 0 ? bin_hi[b] : max3(r_hi,bin_hi[b]);
+                        num += bin_count[b];
+                    }
+                    right_count[b] = num;
+                    right_area[b] = num == 0 ? 0.0 : area(r_lo,r_hi);
+                }
+
+                num = 0;
+                vec3 l_lo, l_hi;
+                for(size_t b(0);b<num_bins-1;++b) {
+                    if(bin_count[b] > 0) {
+                        l_lo = num == 0 ? bin_lo[b] : min3(l_lo,bin_lo[b]);
+                        l_hi = num == 0 ? bin_hi[b] : max3(l_hi,bin_hi[b]);
+                        num += bin_count[b];
+                    }
+                    if(num == 0 or right_count[b+1] == 0) continue;
+                    real cost(num*area(l_lo,l_hi) + right_count[b+1]*right_area[b+1]);
+                    if(cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = k;
+                        best_bin = b;
+                    }
+                }
+            }
+
+            // no split is cheaper than testing all triangles of the node
+            if(best_axis >= 0 and best_cost >= count*area(lo,hi) and count <= 4*leaf_size) continue;
+        }
+
+        size_t mid(begin);
+        if(best_axis >= 0) {
+            real c_0(coord(c_lo,best_axis)), scale(num_bins/(coord(c_hi,best_axis)-c_0));
+            mid = partition(order.begin()+begin,order.begin()+end,[&](uint32_t j) {
+                return min(num_bins-1,size_t((coord(centroid[j],best_axis)-c_0)*scale)) <= best_bin;
+            }) - order.begin();
+        }
+        if(mid == begin or mid == end) {
+            // split at the median of the longest extent of the centroids
+            vec3 ext(c_hi-c_lo);
+            int k = ext.x >= ext.y and ext.x >= ext.z ? 0 : (ext.y >= ext.z ? 1 : 2);
+            mid = begin + count/2;
+            nth_element(order.begin()+begin,order.begin()+mid,order.begin()+end,[&](uint32_t a,uint32_t b) {
+                return coord(centroid[a],k) < coord(centroid[b],k);
+            });
+        }
+
+        size_t child(nodes.size());
+        nodes[n].child = child;
+        nodes.push_back(Node{vec3(),vec3(),uint32_t(begin),uint32_t(mid),0});
+        nodes.push_back(Node{vec3(),vec3(),uint32_t(mid),uint32_t(end),0});
+        todo.push_back({child,depth+1});
+        todo.push_back({child+1,depth+1});
+    }
+
+    // the boxes are enlarged a bit, such that the intersections computed by the triangle
+    // tests (with rounding errors) are always in the boxes of their leaves
+    vec3 ext(nodes[0].hi-nodes[0].lo);
+    vec3 mag(max3(max3(nodes[0].hi,-1.0*nodes[0].hi),max3(nodes[0].lo,-1.0*nodes[0].lo)));
+    real delta(1e-9*(ext.norm() + mag.norm()));
+    for(Node& node : nodes) {
+        node.lo = node.lo - vec3(delta,delta,delta);
+        node.hi = node.hi + vec3(delta,delta,delta);
+    }
+
+    corners.resize(3*m);
+    for(size_t i(0);i<m;++i) {
+        Triplet t(mesh.trigs[order[i]]);
+        corners[3*i]   = mesh.verts[t.a];
+        corners[3*i+1] = mesh.verts[t.b];
+        corners[3*i+2] = mesh.verts[t.c];
+    }
+}
+
+bool MeshBVH::intersect_box(Node const& node,vec3 const& pos,vec3 const& dir,real& s_0,real& s_1) const {
+    s_0 = -numeric_limits<real>::infinity();
+    s_1 =  numeric_limits<real>::infinity();
+    for(int k(0);k<3;++k) {
+        real p(coord(pos,k)), d(coord(dir,k));
+        real lo(coord(node.lo,k)), hi(coord(node.hi,k));
+        if(d == 0.0) {
+            if(p < lo or p > hi) return false;
+            continue;
+        }
+        real t_a((lo-p)/d), t_b((hi-p)/d);
+        if(t_a > t_b) swap(t_a,t_b);
+        s_0 = max(s_0,t_a);
+        s_1 = min(s_1,t_b);
+    }
+    return s_0 <= s_1;
+}
+
+// the triangle tests are the same as in trace_mesh resp. trace_mesh_positive. A node is skipped if
+// all s of the line in its box are further away than the best hit found so far.
+template<bool positive>
+bool MeshBVH::trace_impl(vec3 const& pos,vec3 const& dir,vec3& result,size_t& trig_index) const {
+    if(nodes.empty()) return false;
+
+    real s_min(-1.0);
+    size_t best(0);
+    bool success(false);
+
+    // lower bound of |s| (resp. s) in the box of node, false if there are no admissible s
+    auto bound = [&](Node const& node,real& lower) {
+        real s_0, s_1;
+        if(not intersect_box(node,pos,dir,s_0,s_1)) return false;
+        if(positive) {
+            if(s_1 <= 0.0) return false;
+            lower = max(s_0,0.0);
+        } else {
+            lower = s_0 > 0.0 ? s_0 : (s_1 < 0.0 ? -s_1 : 0.0);
+        }
+        return not (success and lower > s_min);
+    };
+
+    uint32_t stack[stack_size];
+    size_t top(0);
+    real lower;
+    if(bound(nodes[0],lower)) stack[top++] = 0;
+
+    while(top > 0) {
+        Node const& node(nodes[stack[--top]]);
+
+        if(node.child == 0) {
+            if(not bound(node,lower)) continue;
+
+            for(size_t i(node.begin);i<node.end;++i) {
+                vec3 const& A(corners[3*i]);
+                vec3 const& B(corners[3*i+1]);
+                vec3 const& C(corners[3*i+2]);
+
+                vec3 a(B-A);
+                vec3 b(C-B);
+                vec3 c(A-C);
+
+                vec3 n(a.vec(b));
+
+                real s = n.dot(A-pos)/n.dot(dir);
+
+                vec3 x = pos + s*dir;
+
+                if(positive and not (s > 0.0)) continue;
+                real key(positive ? s : abs(s));
+                size_t j(order[i]);
+                if(success and (key > s_min or (key == s_min and j > best))) continue;
+
+                if(     (A-x).vec(a).dot(n) >= 0
+                    and (B-x).vec(b).dot(n) >= 0
+                    and (C-x).vec(c).dot(n) >= 0 ) {
+                        s_min = key;
+                        result = x;
+                        best = j;
+                        success = true;
+                }
+            }
+        } else {
+            // the nearer child is visited first
+            real b_0, b_1;
+            bool hit_0(bound(nodes[node.child],b_0));
+            bool hit_1(bound(nodes[node.child+1],b_1));
+            if(hit_0 and hit_1) {
+                assert(top + 2 <= stack_size);
+                if(b_0 <= b_1) {
+                    stack[top++] = node.child+1;
+                    stack[top++] = node.child;
+                } else {
+                    stack[top++] = node.child;
+                    stack[top++] = node.child+1;
+                }
+            } else if(hit_0) {
+                stack[top++] = node.child;
+            } else if(hit_1) {
+                stack[top++] = node.child+1;
+            }
+        }
+    }
+
+    if(success) trig_index = best;
+    return success;
+}
+
+bool MeshBVH::trace(vec3 const& pos,vec3 const& dir,vec3& result,size_t& trig_index) const {
+    return trace_impl<false>(pos,dir,result,trig_index);
+}
+
+bool MeshBVH::trace_positive(vec3 const& pos,vec3 const& dir,vec3& result,size_t& trig_index) const {
+    return trace_impl<true>(pos,dir,result,trig_index);
+}
+
+} // namespace Bem
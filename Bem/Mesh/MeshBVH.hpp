@@ -0,0 +1,55 @@
+#ifndef MESHBVH_HPP
+#define MESHBVH_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "Mesh.hpp"
+
+namespace Bem {
+
+// The MeshBVH is a bounding volume hierarchy over the triangles of a mesh, used to find the
+// intersections of rays with the mesh (see trace_mesh in MeshManip.hpp) without testing every
+// triangle. The tree is built with the surface area heuristic (binned over the centroids of
+// the triangles) and stored as a flat array of nodes, the two children of a node being adjacent.
+// The corners of the triangles are copied in the order of the leaves, such that the bvh doesn't
+// depend on the mesh anymore after construction (it has to be rebuilt if the mesh changes).
+// The queries return exactly the same results as the loops over all triangles: among the hits
+// with the smallest |s| (resp. s) the one with the lowest triangle index is chosen.
+
+class MeshBVH {
+public:
+
+    MeshBVH(Mesh const& mesh,size_t leaf_size = 4);
+
+    // intersection of the line pos + s*dir with the mesh with minimal |s| (see trace_mesh)
+    bool trace(vec3 const& pos,vec3 const& dir,vec3& result,size_t& trig_index) const;
+    // intersection with minimal positive s (see trace_mesh_positive)
+    bool trace_positive(vec3 const& pos,vec3 const& dir,vec3& result,size_t& trig_index) const;
+
+    size_t num_nodes() const {
+        return nodes.size();
+    }
+
+private:
+
+    struct Node {
+        vec3 lo, hi;             // bounding box
+        uint32_t begin, end;     // range in order
+        uint32_t child;          // index of the first of the two children, zero for leaves
+    };
+
+    // range of s for which pos + s*dir is in the box of node (false if there is none)
+    bool intersect_box(Node const& node,vec3 const& pos,vec3 const& dir,real& s_0,real& s_1) const;
+
+    template<bool positive>
+    bool trace_impl(vec3 const& pos,vec3 const& dir,vec3& result,size_t& trig_index) const;
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> order;   // triangle indices in the order of the leaves
+    std::vector<vec3> corners;     // corners of triangle order[i] at 3*i, 3*i+1, 3*i+2
+};
+
+} // namespace Bem
+
+#endif // MESHBVH_HPP
@@ -535,6 +535,7 @@ void import_ply (std::string filename, Mesh& mesh, std::vector<real>& values) {
     // first, clean everything up.
     mesh.verts.clear();
     mesh.trigs.clear();
+    mesh.connectivity_changed();
     values.clear();
 
 
@@ -703,6 +704,7 @@ void import_ply (string filename, Mesh& mesh, vector<real>& phi, vector<real>& p
     // first, clean everything up.
     mesh.verts.clear();
     mesh.trigs.clear();
+    mesh.connectivity_changed();
     phi.clear();
     psi.clear();
 
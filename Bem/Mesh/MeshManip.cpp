@@ -3,6 +3,7 @@
 #include <iostream>
 #include <algorithm>
 #include <numeric>
+#include <set>
 #include <omp.h> // for project
 
 #include "MeshIO.hpp"
@@ -29,7 +30,7 @@ void split_edges    (HalfedgeMesh& mesh, real L_max) {
     real L_max_2 = L_max*L_max;
     
     for(auto halfedge :mesh.edges) {
-        lengths.push_back((mesh.vpos[halfedge->next->vert]-mesh.vpos[halfedge->vert]).norm2());
+        lengths.push_back((mesh.vpos[mesh.vert(mesh.next(halfedge))]-mesh.vpos[mesh.vert(halfedge)]).norm2());
     }
 
     // reorder the halfedge mesh and lengths such that the longest edges come first
@@ -39,15 +40,15 @@ void split_edges    (HalfedgeMesh& mesh, real L_max) {
     // sort the index list according to the lengths of the edges
     sort(indices.begin(),indices.end(),[&lengths](size_t a,size_t b) { return lengths[a] > lengths[b]; });
 
-    vector<Halfedge*> edges_tmp = mesh.edges;
+    vector<Halfedge> edges_tmp = mesh.edges;
     vector<real> lengths_tmp = lengths;
 
     // apply the permutation stored in indices to lengths and the halfedgemesh
     for(size_t i(0);i<lengths.size();++i) {
         size_t k = indices[i];
         mesh.edges[i] = edges_tmp[k];
-        mesh.edges[i]->edge = i;
-        mesh.edges[i]->twin->edge = i;
+        mesh.edge(mesh.edges[i]) = i;
+        mesh.edge(mesh.twin(mesh.edges[i])) = i;
         lengths[i] = lengths_tmp[k];
         
     }
@@ -60,14 +61,15 @@ void split_edges    (HalfedgeMesh& mesh, real L_max) {
         // check whether edge is longer than L_max
         if(lengths[i] > L_max_2) {
 
-            Halfedge* edge01(mesh.edges[i]);
-            Halfedge* edge10(edge01->twin);
+            Halfedge edge01(mesh.edges[i]);
+            Halfedge edge10(mesh.twin(edge01));
 
-            if(edge01->trig == HalfedgeMesh::npos or edge10->trig == HalfedgeMesh::npos) {
+            if(mesh.trig(edge01) == HalfedgeMesh::npos or mesh.trig(edge10) == HalfedgeMesh::npos) {
                 // a remplir
             } else {
 
-                mesh.vpos.push_back(0.5*(mesh.vpos[edge01->vert]+mesh.vpos[edge01->next->vert]));
+                mesh.vpos.push_back(0.5*(mesh.vpos[mesh.vert(edge01)]+mesh.vpos[mesh.vert(mesh.next(edge01))]));
+                mesh.origin.push_back(mesh.origin[mesh.vert(edge01)]);
                 mesh.verts.push_back(edge10);
                 size_t new_index(mesh.verts.size()-1);
 
@@ -75,62 +77,62 @@ void split_edges    (HalfedgeMesh& mesh, real L_max) {
                 // _0 are Halfedges going out from new_index
                 size_t K(mesh.edges.size());
                 size_t M(mesh.trigs.size());
-                Halfedge* S_0 = new Halfedge;
-                Halfedge* S_1 = new Halfedge;
-                Halfedge* A_0 = new Halfedge;
-                Halfedge* A_1 = new Halfedge;
-                Halfedge* B_0 = new Halfedge;
-                Halfedge* B_1 = new Halfedge;
-
-                S_0->edge = K;
-                S_0->trig = M;
-                S_0->next = edge01->next;
-                S_0->vert = new_index;
-                S_0->twin = S_1;
-
-                S_1->edge = K;
-                S_1->trig = M+1;
-                S_1->next = B_0;
-                S_1->vert = edge01->next->vert;
-                S_1->twin = S_0;
+                Halfedge S_0 = mesh.new_halfedge();
+                Halfedge S_1 = mesh.new_halfedge();
+                Halfedge A_0 = mesh.new_halfedge();
+                Halfedge A_1 = mesh.new_halfedge();
+                Halfedge B_0 = mesh.new_halfedge();
+                Halfedge B_1 = mesh.new_halfedge();
+
+                mesh.edge(S_0) = K;
+                mesh.trig(S_0) = M;
+                mesh.next(S_0) = mesh.next(edge01);
+                mesh.vert(S_0) = new_index;
+                mesh.twin(S_0) = S_1;
+
+                mesh.edge(S_1) = K;
+                mesh.trig(S_1) = M+1;
+                mesh.next(S_1) = B_0;
+                mesh.vert(S_1) = mesh.vert(mesh.next(edge01));
+                mesh.twin(S_1) = S_0;
             
-                A_0->edge = K+1;
-                A_0->trig = edge01->trig;
-                A_0->next = edge01->next->next;
-                A_0->vert = new_index;
-                A_0->twin = A_1;
+                mesh.edge(A_0) = K+1;
+                mesh.trig(A_0) = mesh.trig(edge01);
+                mesh.next(A_0) = mesh.next(mesh.next(edge01));
+                mesh.vert(A_0) = new_index;
+                mesh.twin(A_0) = A_1;
                 
-                A_1->edge = K+1;
-                A_1->trig = M;
-                A_1->next = S_0;
-                A_1->vert = edge01->next->next->vert;
-                A_1->twin = A_0;
+                mesh.edge(A_1) = K+1;
+                mesh.trig(A_1) = M;
+                mesh.next(A_1) = S_0;
+                mesh.vert(A_1) = mesh.vert(mesh.next(mesh.next(edge01)));
+                mesh.twin(A_1) = A_0;
 
-                B_0->edge = K+2;
-                B_0->trig = M+1;
-                B_0->next = edge10->next->next;
-                B_0->vert = new_index;
-                B_0->twin = B_1;
+                mesh.edge(B_0) = K+2;
+                mesh.trig(B_0) = M+1;
+                mesh.next(B_0) = mesh.next(mesh.next(edge10));
+                mesh.vert(B_0) = new_index;
+                mesh.twin(B_0) = B_1;
 
-                B_1->edge = K+2;
-                B_1->trig = edge10->trig;
-                B_1->next = edge10;
-                B_1->vert = edge10->next->next->vert;
-                B_1->twin = B_0;
+                mesh.edge(B_1) = K+2;
+                mesh.trig(B_1) = mesh.trig(edge10);
+                mesh.next(B_1) = edge10;
+                mesh.vert(B_1) = mesh.vert(mesh.next(mesh.next(edge10)));
+                mesh.twin(B_1) = B_0;
 
 
-                edge01->next->trig = M;
-                edge01->next->next = A_1;
-                edge01->next = A_0;
+                mesh.trig(mesh.next(edge01)) = M;
+                mesh.next(mesh.next(edge01)) = A_1;
+                mesh.next(edge01) = A_0;
 
-                edge10->next->next->trig = M+1;
-                edge10->next->next->next = S_1;
-                edge10->next->next = B_1;
-                edge10->vert = new_index;
+                mesh.trig(mesh.next(mesh.next(edge10))) = M+1;
+                mesh.next(mesh.next(mesh.next(edge10))) = S_1;
+                mesh.next(mesh.next(edge10)) = B_1;
+                mesh.vert(edge10) = new_index;
 
-                mesh.verts[S_1->vert] = S_1;
-                mesh.trigs[edge01->trig] = edge01;
-                mesh.trigs[edge10->trig] = edge10;
+                mesh.verts[mesh.vert(S_1)] = S_1;
+                mesh.trigs[mesh.trig(edge01)] = edge01;
+                mesh.trigs[mesh.trig(edge10)] = edge10;
 
 
                 mesh.trigs.push_back(S_0);
@@ -165,7 +167,7 @@ void split_edges    (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
     vector<real> lengths;
     
     for(auto halfedge :mesh.edges) {
-        lengths.push_back((mesh.vpos[halfedge->next->vert]-mesh.vpos[halfedge->vert]).norm2());
+        lengths.push_back((mesh.vpos[mesh.vert(mesh.next(halfedge))]-mesh.vpos[mesh.vert(halfedge)]).norm2());
     }
 
     // reorder the halfedge mesh and lengths such that shortest edges come first
@@ -174,14 +176,14 @@ void split_edges    (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
     iota(indices.begin(),indices.end(),0);
     sort(indices.begin(),indices.end(),[&lengths](size_t a,size_t b) { return lengths[a] > lengths[b]; });
 
-    vector<Halfedge*> edges_tmp = mesh.edges;
+    vector<Halfedge> edges_tmp = mesh.edges;
     vector<real> lengths_tmp = lengths;
 
     for(size_t i(0);i<lengths.size();++i) {
         size_t k = indices[i];
         mesh.edges[i] = edges_tmp[k];
-        mesh.edges[i]->edge = i;
-        mesh.edges[i]->twin->edge = i;
+        mesh.edge(mesh.edges[i]) = i;
+        mesh.edge(mesh.twin(mesh.edges[i])) = i;
         lengths[i] = lengths_tmp[k];
         
     }
@@ -190,18 +192,18 @@ void split_edges    (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
     size_t J(mesh.edges.size());
     for(size_t i(0);i<J;++i) {
 
-        Halfedge* edge01(mesh.edges[i]);
-        Halfedge* edge10(edge01->twin);
+        Halfedge edge01(mesh.edges[i]);
+        Halfedge edge10(mesh.twin(edge01));
 
-        if(edge01->trig == HalfedgeMesh::npos or edge10->trig == HalfedgeMesh::npos) {
+        if(mesh.trig(edge01) == HalfedgeMesh::npos or mesh.trig(edge10) == HalfedgeMesh::npos) {
 
 #if TRUE==TRUE
-            if(edge10->trig == HalfedgeMesh::npos) {
+            if(mesh.trig(edge10) == HalfedgeMesh::npos) {
                 swap(edge01,edge10);
             } // edge01 is at the boundary.
 
-            real curv_0 = curvature[edge01->vert];
-            real curv_1 = curvature[edge10->vert];
+            real curv_0 = curvature[mesh.vert(edge01)];
+            real curv_1 = curvature[mesh.vert(edge10)];
 
             real L_max_2 = 0.0;
             bool zero_curv = false;
@@ -212,7 +214,8 @@ void split_edges    (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
 
             if(lengths[i] > L_max_2 and not zero_curv ) {
 
-                mesh.vpos.push_back(0.5*(mesh.vpos[edge01->vert]+mesh.vpos[edge01->next->vert]));
+                mesh.vpos.push_back(0.5*(mesh.vpos[mesh.vert(edge01)]+mesh.vpos[mesh.vert(mesh.next(edge01))]));
+                mesh.origin.push_back(mesh.origin[mesh.vert(edge01)]);
                 mesh.verts.push_back(edge10);
                 curvature.push_back(0.5*(curv_0+curv_1));
                 size_t new_index(mesh.verts.size()-1);
@@ -220,44 +223,44 @@ void split_edges    (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
                 // S for straight, A, B for the two sides // _0 are from new_index outgoing Halfedges
                 size_t K(mesh.edges.size());
                 size_t M(mesh.trigs.size());
-                Halfedge* S_0 = new Halfedge;
-                Halfedge* S_1 = new Halfedge;
-                Halfedge* B_0 = new Halfedge;
-                Halfedge* B_1 = new Halfedge;
-
-                S_0->edge = K;
-                S_0->trig = HalfedgeMesh::npos;
-                S_0->next = edge01->next;
-                S_0->vert = new_index;
-                S_0->twin = S_1;
-
-                S_1->edge = K;
-                S_1->trig = M;
-                S_1->next = B_0;
-                S_1->vert = edge01->next->vert;
-                S_1->twin = S_0;
-
-                B_0->edge = K+1;
-                B_0->trig = M;
-                B_0->next = edge10->next->next;
-                B_0->vert = new_index;
-                B_0->twin = B_1;
-
-                B_1->edge = K+1;
-                B_1->trig = edge10->trig;
-                B_1->next = edge10;
-                B_1->vert = edge10->next->next->vert;
-                B_1->twin = B_0;
-
-                edge01->next = S_0;
-
-                edge10->next->next->trig = M;
-                edge10->next->next->next = S_1;
-                edge10->next->next = B_1;
-                edge10->vert = new_index;
-
-                mesh.verts[S_1->vert] = S_1;
-                mesh.trigs[edge10->trig] = edge10;
+                Halfedge S_0 = mesh.new_halfedge();
+                Halfedge S_1 = mesh.new_halfedge();
+                Halfedge B_0 = mesh.new_halfedge();
+                Halfedge B_1 = mesh.new_halfedge();
+
+                mesh.edge(S_0) = K;
+                mesh.trig(S_0) = HalfedgeMesh::npos;
+                mesh.next(S_0) = mesh.next(edge01);
+                mesh.vert(S_0) = new_index;
+                mesh.twin(S_0) = S_1;
+
+                mesh.edge(S_1) = K;
+                mesh.trig(S_1) = M;
+                mesh.next(S_1) = B_0;
+                mesh.vert(S_1) = mesh.vert(mesh.next(edge01));
+                mesh.twin(S_1) = S_0;
+
+                mesh.edge(B_0) = K+1;
+                mesh.trig(B_0) = M;
+                mesh.next(B_0) = mesh.next(mesh.next(edge10));
+                mesh.vert(B_0) = new_index;
+                mesh.twin(B_0) = B_1;
+
+                mesh.edge(B_1) = K+1;
+                mesh.trig(B_1) = mesh.trig(edge10);
+                mesh.next(B_1) = edge10;
+                mesh.vert(B_1) = mesh.vert(mesh.next(mesh.next(edge10)));
+                mesh.twin(B_1) = B_0;
+
+                mesh.next(edge01) = S_0;
+
+                mesh.trig(mesh.next(mesh.next(edge10))) = M;
+                mesh.next(mesh.next(mesh.next(edge10))) = S_1;
+                mesh.next(mesh.next(edge10)) = B_1;
+                mesh.vert(edge10) = new_index;
+
+                mesh.verts[mesh.vert(S_1)] = S_1;
+                mesh.trigs[mesh.trig(edge10)] = edge10;
 
 
                 mesh.trigs.push_back(S_1);
@@ -269,8 +272,8 @@ void split_edges    (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
 #endif
         } else {
 
-            real curv_0 = curvature[edge01->vert];
-            real curv_1 = curvature[edge10->vert];
+            real curv_0 = curvature[mesh.vert(edge01)];
+            real curv_1 = curvature[mesh.vert(edge10)];
 
             real L_max_2 = 0.0;
             bool zero_curv = false;
@@ -281,7 +284,8 @@ void split_edges    (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
 
             if(lengths[i] > L_max_2 and not zero_curv ) {
 
-                mesh.vpos.push_back(0.5*(mesh.vpos[edge01->vert]+mesh.vpos[edge01->next->vert]));
+                mesh.vpos.push_back(0.5*(mesh.vpos[mesh.vert(edge01)]+mesh.vpos[mesh.vert(mesh.next(edge01))]));
+                mesh.origin.push_back(mesh.origin[mesh.vert(edge01)]);
                 mesh.verts.push_back(edge10);
                 curvature.push_back(0.5*(curv_0+curv_1));
                 size_t new_index(mesh.verts.size()-1);
@@ -289,62 +293,62 @@ void split_edges    (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
                 // S for straight, A, B for the two sides // _0 are from new_index outgoing Halfedges
                 size_t K(mesh.edges.size());
                 size_t M(mesh.trigs.size());
-                Halfedge* S_0 = new Halfedge;
-                Halfedge* S_1 = new Halfedge;
-                Halfedge* A_0 = new Halfedge;
-                Halfedge* A_1 = new Halfedge;
-                Halfedge* B_0 = new Halfedge;
-                Halfedge* B_1 = new Halfedge;
-
-                S_0->edge = K;
-                S_0->trig = M;
-                S_0->next = edge01->next;
-                S_0->vert = new_index;
-                S_0->twin = S_1;
-
-                S_1->edge = K;
-                S_1->trig = M+1;
-                S_1->next = B_0;
-                S_1->vert = edge01->next->vert;
-                S_1->twin = S_0;
+                Halfedge S_0 = mesh.new_halfedge();
+                Halfedge S_1 = mesh.new_halfedge();
+                Halfedge A_0 = mesh.new_halfedge();
+                Halfedge A_1 = mesh.new_halfedge();
+                Halfedge B_0 = mesh.new_halfedge();
+                Halfedge B_1 = mesh.new_halfedge();
+
+                mesh.edge(S_0) = K;
+                mesh.trig(S_0) = M;
+                mesh.next(S_0) = mesh.next(edge01);
+                mesh.vert(S_0) = new_index;
+                mesh.twin(S_0) = S_1;
+
+                mesh.edge(S_1) = K;
+                mesh.trig(S_1) = M+1;
+                mesh.next(S_1) = B_0;
+                mesh.vert(S_1) = mesh.vert(mesh.next(edge01));
+                mesh.twin(S_1) = S_0;
             
-                A_0->edge = K+1;
-                A_0->trig = edge01->trig;
-                A_0->next = edge01->next->next;
-                A_0->vert = new_index;
-                A_0->twin = A_1;
+                mesh.edge(A_0) = K+1;
+                mesh.trig(A_0) = mesh.trig(edge01);
+                mesh.next(A_0) = mesh.next(mesh.next(edge01));
+                mesh.vert(A_0) = new_index;
+                mesh.twin(A_0) = A_1;
                 
-                A_1->edge = K+1;
-                A_1->trig = M;
-                A_1->next = S_0;
-                A_1->vert = edge01->next->next->vert;
-                A_1->twin = A_0;
+                mesh.edge(A_1) = K+1;
+                mesh.trig(A_1) = M;
+                mesh.next(A_1) = S_0;
+                mesh.vert(A_1) = mesh.vert(mesh.next(mesh.next(edge01)));
+                mesh.twin(A_1) = A_0;
 
-                B_0->edge = K+2;
-                B_0->trig = M+1;
-                B_0->next = edge10->next->next;
-                B_0->vert = new_index;
-                B_0->twin = B_1;
+                mesh.edge(B_0) = K+2;
+                mesh.trig(B_0) = M+1;
+                mesh.next(B_0) = mesh.next(mesh.next(edge10));
+                mesh.vert(B_0) = new_index;
+                mesh.twin(B_0) = B_1;
 
-                B_1->edge = K+2;
-                B_1->trig = edge10->trig;
-                B_1->next = edge10;
-                B_1->vert = edge10->next->next->vert;
-                B_1->twin = B_0;
+                mesh.edge(B_1) = K+2;
+                mesh.trig(B_1) = mesh.trig(edge10);
+                mesh.next(B_1) = edge10;
+                mesh.vert(B_1) = mesh.vert(mesh.next(mesh.next(edge10)));
+                mesh.twin(B_1) = B_0;
 
 
-                edge01->next->trig = M;
-                edge01->next->next = A_1;
-                edge01->next = A_0;
+                mesh.trig(mesh.next(edge01)) = M;
+                mesh.next(mesh.next(edge01)) = A_1;
+                mesh.next(edge01) = A_0;
 
-                edge10->next->next->trig = M+1;
-                edge10->next->next->next = S_1;
-                edge10->next->next = B_1;
-                edge10->vert = new_index;
+                mesh.trig(mesh.next(mesh.next(edge10))) = M+1;
+                mesh.next(mesh.next(mesh.next(edge10))) = S_1;
+                mesh.next(mesh.next(edge10)) = B_1;
+                mesh.vert(edge10) = new_index;
 
-                mesh.verts[S_1->vert] = S_1;
-                mesh.trigs[edge01->trig] = edge01;
-                mesh.trigs[edge10->trig] = edge10;
+                mesh.verts[mesh.vert(S_1)] = S_1;
+                mesh.trigs[mesh.trig(edge01)] = edge01;
+                mesh.trigs[mesh.trig(edge10)] = edge10;
 
 
                 mesh.trigs.push_back(S_0);
@@ -365,45 +369,95 @@ void split_edges    (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
 // for the collapse_edge function we need to be able to remove individual elements
 // from the HalfedgeMesh. Here are some functions provided that render this task a bit easier
 
-void remove_edge(vector<Halfedge*>& edges,size_t edge_ind) {
+void remove_edge(HalfedgeMesh& mesh,size_t edge_ind) {
+    vector<Halfedge>& edges(mesh.edges);
     if(edge_ind != edges.size()-1) {
         swap(edges[edge_ind],edges.back());
-        Halfedge* u(edges[edge_ind]);
-        u->edge = edge_ind;
-        u->twin->edge = edge_ind;
+        Halfedge u(edges[edge_ind]);
+        mesh.edge(u) = edge_ind;
+        mesh.edge(mesh.twin(u)) = edge_ind;
     }
     edges.pop_back();
 }
 
-void remove_vertex(vector<Halfedge*>& verts,size_t vert_ind) {
+void remove_vertex(HalfedgeMesh& mesh,size_t vert_ind) {
+    vector<Halfedge>& verts(mesh.verts);
     if(vert_ind != verts.size()-1) {
         swap(verts[vert_ind],verts.back());
-        Halfedge* u(verts[vert_ind]);
-        Halfedge* v(u);
+        Halfedge u(verts[vert_ind]);
+        Halfedge v(u);
         do {
-            v->vert = vert_ind;
-            v = v->twin->next;
+            mesh.vert(v) = vert_ind;
+            v = mesh.next(mesh.twin(v));
         } while(v != u);
     }
     verts.pop_back();
 }
 
-void remove_face(vector<Halfedge*>& faces,size_t face_ind) {
+void remove_face(HalfedgeMesh& mesh,size_t face_ind) {
+    vector<Halfedge>& faces(mesh.trigs);
     if(face_ind != faces.size()-1) {
         swap(faces[face_ind],faces.back());
-        Halfedge* u(faces[face_ind]);
-        u->trig = face_ind;
-        u->next->trig = face_ind;
-        u->next->next->trig = face_ind;
+        Halfedge u(faces[face_ind]);
+        mesh.trig(u) = face_ind;
+        mesh.trig(mesh.next(u)) = face_ind;
+        mesh.trig(mesh.next(mesh.next(u))) = face_ind;
     }
     faces.pop_back();
 }
 
-bool at_boundary(Halfedge* vert) {
-    Halfedge* u(vert);
+// collapse_edges restarts its search at the beginning of the (sorted) list of edges after every collapse.
+// A collapse only changes the mesh around the merged vertex though, the other edges which were already
+// tested still can't be collapsed. The EdgeScan keeps track of the edges that have to be tested again
+// (pending), such that the search jumps over the others and finds the same edge as the complete loop.
+class EdgeScan {
+public:
+    EdgeScan() :frontier(0) {}
+
+    // the index of the next edge to test, after edge k has been tested
+    size_t next(size_t k) {
+        pending.erase(k);
+        frontier = max(frontier,k+1);
+        auto it(pending.upper_bound(k));
+        if(it != pending.end() and *it < frontier) return *it;
+        return frontier;
+    }
+
+    // the edge at index edge_ind has changed
+    void touch(size_t edge_ind) {
+        pending.insert(edge_ind);
+    }
+
+    // all edges of the vertices in the one ring of vert (and vert itself) have changed
+    void touch_neighbourhood(HalfedgeMesh const& mesh,size_t vert) {
+        Halfedge u(mesh.verts[vert]);
+        do {
+            Halfedge v(mesh.verts[mesh.vert(mesh.next(u))]);
+            Halfedge w(v);
+            do {
+                touch(mesh.edge(w));
+                w = mesh.next(mesh.twin(w));
+            } while(w != v);
+            u = mesh.next(mesh.twin(u));
+        } while(u != mesh.verts[vert]);
+    }
+
+private:
+    size_t frontier;        // all edges before frontier have been tested
+    std::set<size_t> pending;
+};
+
+// remove_edge for collapse_edges: the edge moved to edge_ind has to be tested
+void remove_edge(HalfedgeMesh& mesh,size_t edge_ind,EdgeScan& scan) {
+    scan.touch(edge_ind);
+    remove_edge(mesh,edge_ind);
+}
+
+bool at_boundary(HalfedgeMesh const& mesh,Halfedge vert) {
+    Halfedge u(vert);
     do {
-        if(u->trig == HalfedgeMesh::npos or u->twin->trig == HalfedgeMesh::npos) return true;
-        u = u->twin->next;
+        if(mesh.trig(u) == HalfedgeMesh::npos or mesh.trig(mesh.twin(u)) == HalfedgeMesh::npos) return true;
+        u = mesh.next(mesh.twin(u));
     } while(u != vert);
     return false;
 }
@@ -423,7 +477,7 @@ void collapse_edges (HalfedgeMesh& mesh, real L_min) {
     real L_min_2 = L_min*L_min;
     
     for(auto halfedge :mesh.edges) {
-        lengths.push_back((mesh.vpos[halfedge->next->vert]-mesh.vpos[halfedge->vert]).norm2());
+        lengths.push_back((mesh.vpos[mesh.vert(mesh.next(halfedge))]-mesh.vpos[mesh.vert(halfedge)]).norm2());
     }
 
     // reorder the halfedge mesh and lengths such that shortest edges come first
@@ -432,56 +486,57 @@ void collapse_edges (HalfedgeMesh& mesh, real L_min) {
     iota(indices.begin(),indices.end(),0);
     sort(indices.begin(),indices.end(),[&lengths](size_t a,size_t b) { return lengths[a] < lengths[b]; });
 
-    vector<Halfedge*> edges_tmp = mesh.edges;
+    vector<Halfedge> edges_tmp = mesh.edges;
     vector<real> lengths_tmp = lengths;
 
     for(size_t i(0);i<lengths.size();++i) {
         size_t k = indices[i];
         mesh.edges[i] = edges_tmp[k];
-        mesh.edges[i]->edge = i;
-        mesh.edges[i]->twin->edge = i;
+        mesh.edge(mesh.edges[i]) = i;
+        mesh.edge(mesh.twin(mesh.edges[i])) = i;
         lengths[i] = lengths_tmp[k];
         
     }
 
     // looping through the edges while the edges-array becomes smaller
-    for(size_t k(0);k<mesh.edges.size();++k) {
+    EdgeScan scan;
+    for(size_t k(0);k<mesh.edges.size();k = scan.next(k)) {
 
         // check whether the current edge is shorter than the minimum length
         if(lengths[k] < L_min_2) {
 
-            Halfedge* halfedge_A = mesh.edges[k];
-            Halfedge* halfedge_B = halfedge_A->twin;
+            Halfedge halfedge_A = mesh.edges[k];
+            Halfedge halfedge_B = mesh.twin(halfedge_A);
 
-            if(halfedge_A->trig == HalfedgeMesh::npos or halfedge_B->trig == HalfedgeMesh::npos
-               or halfedge_A->next->trig == HalfedgeMesh::npos or halfedge_A->next->next->trig == HalfedgeMesh::npos
-               or halfedge_B->next->trig == HalfedgeMesh::npos or halfedge_B->next->next->trig == HalfedgeMesh::npos) {
+            if(mesh.trig(halfedge_A) == HalfedgeMesh::npos or mesh.trig(halfedge_B) == HalfedgeMesh::npos
+               or mesh.trig(mesh.next(halfedge_A)) == HalfedgeMesh::npos or mesh.trig(mesh.next(mesh.next(halfedge_A))) == HalfedgeMesh::npos
+               or mesh.trig(mesh.next(halfedge_B)) == HalfedgeMesh::npos or mesh.trig(mesh.next(mesh.next(halfedge_B))) == HalfedgeMesh::npos) {
 
             } else {
 
-                size_t vert_0 = halfedge_A->vert;
-                size_t vert_1 = halfedge_B->vert;
+                size_t vert_0 = mesh.vert(halfedge_A);
+                size_t vert_1 = mesh.vert(halfedge_B);
 
-                if(not (at_boundary(mesh.verts[vert_0]) or at_boundary(mesh.verts[vert_1]))) {
+                if(not (at_boundary(mesh,mesh.verts[vert_0]) or at_boundary(mesh,mesh.verts[vert_1]))) {
 
-                    size_t vert_A = halfedge_A->next->next->vert;
-                    size_t vert_B = halfedge_B->next->next->vert;
+                    size_t vert_A = mesh.vert(mesh.next(mesh.next(halfedge_A)));
+                    size_t vert_B = mesh.vert(mesh.next(mesh.next(halfedge_B)));
 
                     size_t num_paths(0);
 
-                    Halfedge* finder = mesh.verts[vert_0];
-                    Halfedge* init = finder;
+                    Halfedge finder = mesh.verts[vert_0];
+                    Halfedge init = finder;
                     do {
-                        Halfedge* second = finder->next;
-                        Halfedge* second_init = second;
+                        Halfedge second = mesh.next(finder);
+                        Halfedge second_init = second;
                         do {
-                            if(second->next->vert == vert_1) {
+                            if(mesh.vert(mesh.next(second)) == vert_1) {
                                 num_paths++;
                             }
-                            second = second->twin->next;
+                            second = mesh.next(mesh.twin(second));
                         } while(second != second_init);
 
-                        finder = finder->twin->next;
+                        finder = mesh.next(mesh.twin(finder));
                     } while(finder != init);
 
 
@@ -505,15 +560,15 @@ void collapse_edges (HalfedgeMesh& mesh, real L_min) {
 
                         double limit_value = 0.8;
 
-                        Halfedge* u(halfedge_A->next->twin);
+                        Halfedge u(mesh.twin(mesh.next(halfedge_A)));
                         do {
-                            if(u == halfedge_B->next->next) {
-                                u = halfedge_B->next->twin;
+                            if(u == mesh.next(mesh.next(halfedge_B))) {
+                                u = mesh.twin(mesh.next(halfedge_B));
                                 old_pos = mesh.vpos[vert_0];
                             }
-                            vec3 a = mesh.vpos[u->vert] - mesh.vpos[u->next->next->vert];
-                            vec3 b = mesh.vpos[u->next->next->vert] - new_pos;
-                            vec3 c = mesh.vpos[u->next->next->vert] - old_pos;
+                            vec3 a = mesh.vpos[mesh.vert(u)] - mesh.vpos[mesh.vert(mesh.next(mesh.next(u)))];
+                            vec3 b = mesh.vpos[mesh.vert(mesh.next(mesh.next(u)))] - new_pos;
+                            vec3 c = mesh.vpos[mesh.vert(mesh.next(mesh.next(u)))] - old_pos;
 
                             c = c.vec(a);
                             c.normalize();
@@ -521,9 +576,9 @@ void collapse_edges (HalfedgeMesh& mesh, real L_min) {
                             b.normalize();
 
                             if(b.dot(c)<limit_value) valid = false;
-                            u = u->next->twin;
+                            u = mesh.twin(mesh.next(u));
 
-                        } while(valid and u != halfedge_A->next->next);
+                        } while(valid and u != mesh.next(mesh.next(halfedge_A)));
 
 
                         if(valid) {
@@ -531,80 +586,82 @@ void collapse_edges (HalfedgeMesh& mesh, real L_min) {
                             // remove the elements
 
                             // remove the three edges
-                            remove_edge(mesh.edges,halfedge_A->next->edge);
-                            remove_edge(mesh.edges,halfedge_B->next->next->edge);
-                            remove_edge(mesh.edges,halfedge_A->edge);
+                            remove_edge(mesh,mesh.edge(mesh.next(halfedge_A)),scan);
+                            remove_edge(mesh,mesh.edge(mesh.next(mesh.next(halfedge_B))),scan);
+                            remove_edge(mesh,mesh.edge(halfedge_A),scan);
 
-                            swap(lengths[halfedge_A->next->edge],lengths.back());
+                            swap(lengths[mesh.edge(mesh.next(halfedge_A))],lengths.back());
                             lengths.pop_back();
-                            swap(lengths[halfedge_B->next->next->edge],lengths.back());
+                            swap(lengths[mesh.edge(mesh.next(mesh.next(halfedge_B)))],lengths.back());
                             lengths.pop_back();
-                            swap(lengths[halfedge_A->edge],lengths.back());
+                            swap(lengths[mesh.edge(halfedge_A)],lengths.back());
                             lengths.pop_back();
 
 
                             // remove the two faces
-                            remove_face(mesh.trigs,halfedge_A->trig);
-                            remove_face(mesh.trigs,halfedge_B->trig);
+                            remove_face(mesh,mesh.trig(halfedge_A));
+                            remove_face(mesh,mesh.trig(halfedge_B));
 
 
                             // make sure that vert_0 has an halfedge index that wont be removed
                             // the same for vert_A and vert_B
-                            mesh.verts[vert_0] = halfedge_A->next->next->twin;
-                            mesh.verts[vert_A] = halfedge_A->next->twin;
-                            mesh.verts[vert_B] = halfedge_B->next->twin;
+                            mesh.verts[vert_0] = mesh.twin(mesh.next(mesh.next(halfedge_A)));
+                            mesh.verts[vert_A] = mesh.twin(mesh.next(halfedge_A));
+                            mesh.verts[vert_B] = mesh.twin(mesh.next(halfedge_B));
 
-                            remove_vertex(mesh.verts,vert_1);
+                            remove_vertex(mesh,vert_1);
 
                             // adjust the real vertices of the mesh
                             mesh.vpos[vert_0] = new_pos;
                             swap(mesh.vpos[vert_1],mesh.vpos.back());
                             mesh.vpos.pop_back();
+                            swap(mesh.origin[vert_1],mesh.origin.back());
+                            mesh.origin.pop_back();
 
                             // in case that we just swapped vert_0, adjust it here (since we use it later on)
                             if(vert_0 == mesh.verts.size()) vert_0 = vert_1;
 
                             // move pointers from vert_1 to vert_0
-                            Halfedge* current = halfedge_A->next;
+                            Halfedge current = mesh.next(halfedge_A);
                             while( current != halfedge_B) {
-                                current->vert = vert_0;
-                                current = current->twin->next;
+                                mesh.vert(current) = vert_0;
+                                current = mesh.next(mesh.twin(current));
                             }
 
                             // make sure that the edges of triangle A and B that WEREN'T removed, 
                             // will still have a valid halfedge pointer
-                            mesh.edges[halfedge_A->next->next->edge] = halfedge_A->next->next->twin;
-                            mesh.edges[halfedge_B->next->edge] = halfedge_B->next->twin;
+                            mesh.edges[mesh.edge(mesh.next(mesh.next(halfedge_A)))] = mesh.twin(mesh.next(mesh.next(halfedge_A)));
+                            mesh.edges[mesh.edge(mesh.next(halfedge_B))] = mesh.twin(mesh.next(halfedge_B));
 
                             // now handle twins (before we destroy structure)
-                            halfedge_A->next->next->twin->twin = halfedge_A->next->twin;
-                            halfedge_A->next->twin->twin = halfedge_A->next->next->twin;
-                            halfedge_A->next->twin->edge = halfedge_A->next->next->edge;
+                            mesh.twin(mesh.twin(mesh.next(mesh.next(halfedge_A)))) = mesh.twin(mesh.next(halfedge_A));
+                            mesh.twin(mesh.twin(mesh.next(halfedge_A))) = mesh.twin(mesh.next(mesh.next(halfedge_A)));
+                            mesh.edge(mesh.twin(mesh.next(halfedge_A))) = mesh.edge(mesh.next(mesh.next(halfedge_A)));
 
-                            halfedge_B->next->next->twin->twin = halfedge_B->next->twin;
-                            halfedge_B->next->twin->twin = halfedge_B->next->next->twin;
-                            halfedge_B->next->next->twin->edge = halfedge_B->next->edge;
+                            mesh.twin(mesh.twin(mesh.next(mesh.next(halfedge_B)))) = mesh.twin(mesh.next(halfedge_B));
+                            mesh.twin(mesh.twin(mesh.next(halfedge_B))) = mesh.twin(mesh.next(mesh.next(halfedge_B)));
+                            mesh.edge(mesh.twin(mesh.next(mesh.next(halfedge_B)))) = mesh.edge(mesh.next(halfedge_B));
 
                             // finally remove the halfedges
 
-                            delete halfedge_A->next->next;
-                            delete halfedge_A->next;
-                            delete halfedge_A;
+                            mesh.delete_halfedge(mesh.next(mesh.next(halfedge_A)));
+                            mesh.delete_halfedge(mesh.next(halfedge_A));
+                            mesh.delete_halfedge(halfedge_A);
 
-                            delete halfedge_B->next->next;
-                            delete halfedge_B->next;
-                            delete halfedge_B;
+                            mesh.delete_halfedge(mesh.next(mesh.next(halfedge_B)));
+                            mesh.delete_halfedge(mesh.next(halfedge_B));
+                            mesh.delete_halfedge(halfedge_B);
 
                             // adjust lengths
 
-                            Halfedge* half_0 = mesh.verts[vert_0];
+                            Halfedge half_0 = mesh.verts[vert_0];
                             current = half_0;
                             do {
-                                lengths[current->edge] = (mesh.vpos[current->next->vert]-mesh.vpos[current->vert]).norm2();
-                                current = current->twin->next;
+                                lengths[mesh.edge(current)] = (mesh.vpos[mesh.vert(mesh.next(current))]-mesh.vpos[mesh.vert(current)]).norm2();
+                                current = mesh.next(mesh.twin(current));
                             } while( current != half_0);
 
-                            
+                            scan.touch_neighbourhood(mesh,vert_0);
                             k = 0;
 
                         }
@@ -630,7 +687,7 @@ void collapse_edges (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
     vector<real> lengths;
     
     for(auto halfedge :mesh.edges) {
-        lengths.push_back((mesh.vpos[halfedge->next->vert]-mesh.vpos[halfedge->vert]).norm2());
+        lengths.push_back((mesh.vpos[mesh.vert(mesh.next(halfedge))]-mesh.vpos[mesh.vert(halfedge)]).norm2());
     }
 
     // reorder the halfedge mesh and lengths such that shortest edges come first
@@ -639,41 +696,42 @@ void collapse_edges (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
     iota(indices.begin(),indices.end(),0);
     sort(indices.begin(),indices.end(),[&lengths](size_t a,size_t b) { return lengths[a] < lengths[b]; });
 
-    vector<Halfedge*> edges_tmp = mesh.edges;
+    vector<Halfedge> edges_tmp = mesh.edges;
     vector<real> lengths_tmp = lengths;
 
     for(size_t i(0);i<lengths.size();++i) {
         size_t k = indices[i];
         mesh.edges[i] = edges_tmp[k];
-        mesh.edges[i]->edge = i;
-        mesh.edges[i]->twin->edge = i;
+        mesh.edge(mesh.edges[i]) = i;
+        mesh.edge(mesh.twin(mesh.edges[i])) = i;
         lengths[i] = lengths_tmp[k];
         
     }
 
 
-    for(size_t k(0);k<mesh.edges.size();++k) {
+    EdgeScan scan;
+    for(size_t k(0);k<mesh.edges.size();k = scan.next(k)) {
 
         //cout << "is it happening here?" << endl;
         //if(not mesh.check_validity()) cout << "mesh invalid!" << endl; // attentiion, takes ages!!
         //cout << "noo" << endl;
 
-        Halfedge* halfedge_A = mesh.edges[k];
-        Halfedge* halfedge_B = halfedge_A->twin;
+        Halfedge halfedge_A = mesh.edges[k];
+        Halfedge halfedge_B = mesh.twin(halfedge_A);
 
-        if(halfedge_A->trig == HalfedgeMesh::npos or halfedge_B->trig == HalfedgeMesh::npos) {
+        if(mesh.trig(halfedge_A) == HalfedgeMesh::npos or mesh.trig(halfedge_B) == HalfedgeMesh::npos) {
 
 
             // BOUNDARY CASE:
 
 #if TRUE==TRUE
 
-            if(halfedge_B->trig == HalfedgeMesh::npos) {
+            if(mesh.trig(halfedge_B) == HalfedgeMesh::npos) {
                 swap(halfedge_A,halfedge_B);
             } // halfedge_A is at the boundary now.
 
-            real curv_0 = curvature[halfedge_A->vert];
-            real curv_1 = curvature[halfedge_B->vert];
+            real curv_0 = curvature[mesh.vert(halfedge_A)];
+            real curv_1 = curvature[mesh.vert(halfedge_B)];
 
             real L_min_2 = 0.0;
             bool zero_curv = false;
@@ -684,26 +742,26 @@ void collapse_edges (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
 
             if(lengths[k] < L_min_2 or zero_curv) { // and if halfedge_A->next->next->next != halfedge_A -> won't be a problem for us
 
-                size_t vert_0 = halfedge_A->vert;
-                size_t vert_1 = halfedge_B->vert;
+                size_t vert_0 = mesh.vert(halfedge_A);
+                size_t vert_1 = mesh.vert(halfedge_B);
 
-                size_t vert_B = halfedge_B->next->next->vert;
+                size_t vert_B = mesh.vert(mesh.next(mesh.next(halfedge_B)));
 
                 size_t num_paths(0);
 
-                Halfedge* finder = mesh.verts[vert_0];
-                Halfedge* init = finder;
+                Halfedge finder = mesh.verts[vert_0];
+                Halfedge init = finder;
                 do {
-                    Halfedge* second = finder->next;
-                    Halfedge* second_init = second;
+                    Halfedge second = mesh.next(finder);
+                    Halfedge second_init = second;
                     do {
-                        if(second->next->vert == vert_1) {
+                        if(mesh.vert(mesh.next(second)) == vert_1) {
                             num_paths++;
                         }
-                        second = second->twin->next;
+                        second = mesh.next(mesh.twin(second));
                     } while(second != second_init);
 
-                    finder = finder->twin->next;
+                    finder = mesh.next(mesh.twin(finder));
                 } while(finder != init);
 
                 if(num_paths == 1) {
@@ -715,15 +773,15 @@ void collapse_edges (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
 
                     double limit_value = 0.8;
 
-                    Halfedge* u(halfedge_A->next->twin); // same as no-boundary-case
+                    Halfedge u(mesh.twin(mesh.next(halfedge_A))); // same as no-boundary-case
                     do {
-                        if(u == halfedge_B->next->next) {
-                            u = halfedge_B->next->twin;
+                        if(u == mesh.next(mesh.next(halfedge_B))) {
+                            u = mesh.twin(mesh.next(halfedge_B));
                             old_pos = mesh.vpos[vert_0];
                         }
-                        vec3 a = mesh.vpos[u->vert] - mesh.vpos[u->next->next->vert];
-                        vec3 b = mesh.vpos[u->next->next->vert] - new_pos;
-                        vec3 c = mesh.vpos[u->next->next->vert] - old_pos;
+                        vec3 a = mesh.vpos[mesh.vert(u)] - mesh.vpos[mesh.vert(mesh.next(mesh.next(u)))];
+                        vec3 b = mesh.vpos[mesh.vert(mesh.next(mesh.next(u)))] - new_pos;
+                        vec3 c = mesh.vpos[mesh.vert(mesh.next(mesh.next(u)))] - old_pos;
 
                         c = c.vec(a);
                         c.normalize();
@@ -731,40 +789,42 @@ void collapse_edges (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
                         b.normalize();
 
                         if(b.dot(c)<limit_value) valid = false;
-                        u = u->next->twin;
+                        u = mesh.twin(mesh.next(u));
 
-                    } while(valid and u->trig != HalfedgeMesh::npos); // back at boundary
+                    } while(valid and mesh.trig(u) != HalfedgeMesh::npos); // back at boundary
 
-                    Halfedge* before_A = u;
+                    Halfedge before_A = u;
 
                     if(valid) {
 
                         // remove the elements
 
                         // remove the two edges
-                        remove_edge(mesh.edges,halfedge_B->next->next->edge);
-                        remove_edge(mesh.edges,halfedge_A->edge);
+                        remove_edge(mesh,mesh.edge(mesh.next(mesh.next(halfedge_B))),scan);
+                        remove_edge(mesh,mesh.edge(halfedge_A),scan);
 
-                        swap(lengths[halfedge_B->next->next->edge],lengths.back());
+                        swap(lengths[mesh.edge(mesh.next(mesh.next(halfedge_B)))],lengths.back());
                         lengths.pop_back();
-                        swap(lengths[halfedge_A->edge],lengths.back());
+                        swap(lengths[mesh.edge(halfedge_A)],lengths.back());
                         lengths.pop_back();
 
 
                         // remove the face
-                        remove_face(mesh.trigs,halfedge_B->trig);
+                        remove_face(mesh,mesh.trig(halfedge_B));
 
-                        //cout << " number faces: " << mesh.trigs.size() << ", removed ind: " << halfedge_B->trig << endl;
+                        //cout << " number faces: " << mesh.trigs.size() << ", removed ind: " << mesh.trig(halfedge_B) << endl;
 
 
                         
 
-                        remove_vertex(mesh.verts,vert_1);
+                        remove_vertex(mesh,vert_1);
 
                         // adjust the real vertices of the mesh
                         mesh.vpos[vert_0] = new_pos;
                         swap(mesh.vpos[vert_1],mesh.vpos.back());
                         mesh.vpos.pop_back();
+                        swap(mesh.origin[vert_1],mesh.origin.back());
+                        mesh.origin.pop_back();
 
                         // and the curvature values
                         curvature[vert_0] = 0.5*(curv_0+curv_1);
@@ -783,49 +843,49 @@ void collapse_edges (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
                         }
 
                         // move pointers from vert_1 to vert_0
-                        Halfedge* current = halfedge_A->next;
+                        Halfedge current = mesh.next(halfedge_A);
                         while( current != halfedge_B) {
-                            current->vert = vert_0;
-                            current = current->twin->next;
+                            mesh.vert(current) = vert_0;
+                            current = mesh.next(mesh.twin(current));
                         }
 
                         // make sure that vert_0 has an halfedge index that wont be removed
                         // the same for vert_B
-                        mesh.verts[vert_0] = halfedge_A->next;
-                        mesh.verts[vert_B] = halfedge_B->next->twin;
+                        mesh.verts[vert_0] = mesh.next(halfedge_A);
+                        mesh.verts[vert_B] = mesh.twin(mesh.next(halfedge_B));
 
                         // make sure that the edges of triangle B that WEREN'T removed, 
                         // will still have a valid halfedge pointer
-                        mesh.edges[halfedge_B->next->edge] = halfedge_B->next->twin;
+                        mesh.edges[mesh.edge(mesh.next(halfedge_B))] = mesh.twin(mesh.next(halfedge_B));
 
-                        before_A->next = halfedge_A->next;
+                        mesh.next(before_A) = mesh.next(halfedge_A);
 
                         // now handle twins (before we destroy structure)
-                        halfedge_B->next->next->twin->twin = halfedge_B->next->twin;
-                        halfedge_B->next->twin->twin = halfedge_B->next->next->twin;
-                        halfedge_B->next->next->twin->edge = halfedge_B->next->edge;
+                        mesh.twin(mesh.twin(mesh.next(mesh.next(halfedge_B)))) = mesh.twin(mesh.next(halfedge_B));
+                        mesh.twin(mesh.twin(mesh.next(halfedge_B))) = mesh.twin(mesh.next(mesh.next(halfedge_B)));
+                        mesh.edge(mesh.twin(mesh.next(mesh.next(halfedge_B)))) = mesh.edge(mesh.next(halfedge_B));
 
-                        for(Halfedge*& elm : mesh.bounds) {
+                        for(Halfedge& elm : mesh.bounds) {
                             if(elm == halfedge_A) {
-                                elm = halfedge_A->next;
+                                elm = mesh.next(halfedge_A);
                             }
                         }
 
                         // finally remove the halfedges
 
-                        delete halfedge_A;
+                        mesh.delete_halfedge(halfedge_A);
 
-                        delete halfedge_B->next->next;
-                        delete halfedge_B->next;
-                        delete halfedge_B;
+                        mesh.delete_halfedge(mesh.next(mesh.next(halfedge_B)));
+                        mesh.delete_halfedge(mesh.next(halfedge_B));
+                        mesh.delete_halfedge(halfedge_B);
 
                         // adjust lengths
 
-                        Halfedge* half_0 = mesh.verts[vert_0];
+                        Halfedge half_0 = mesh.verts[vert_0];
                         current = half_0;
                         do {
-                            lengths[current->edge] = (mesh.vpos[current->next->vert]-mesh.vpos[current->vert]).norm2();
-                            current = current->twin->next;
+                            lengths[mesh.edge(current)] = (mesh.vpos[mesh.vert(mesh.next(current))]-mesh.vpos[mesh.vert(current)]).norm2();
+                            current = mesh.next(mesh.twin(current));
                         } while( current != half_0);
 
                         /*
@@ -833,32 +893,33 @@ void collapse_edges (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
                         current = half_0;
                         do {
                             num_bound++;
-                            Halfedge* mini = current;
+                            Halfedge mini = current;
                             size_t valence(0);
                             do {
                                 valence++;
-                                mini = mini->twin->next;
-                                if(mini->vert != current->vert) cout << "x_";
+                                mini = mesh.next(mesh.twin(mini));
+                                if(mesh.vert(mini) != mesh.vert(current)) cout << "x_";
                             } while(mini != current);
                             cout << valence << '_';
 
-                            current = current->next;
+                            current = mesh.next(current);
                         } while(current != half_0);
                         */
                         
+                        scan.touch_neighbourhood(mesh,vert_0);
                         k = 0;
                     }
                 }
             }
 #endif
-        } else if (halfedge_A->next->trig == HalfedgeMesh::npos or halfedge_A->next->next->trig == HalfedgeMesh::npos
-           or halfedge_B->next->trig == HalfedgeMesh::npos or halfedge_B->next->next->trig == HalfedgeMesh::npos) {
+        } else if (mesh.trig(mesh.next(halfedge_A)) == HalfedgeMesh::npos or mesh.trig(mesh.next(mesh.next(halfedge_A))) == HalfedgeMesh::npos
+           or mesh.trig(mesh.next(halfedge_B)) == HalfedgeMesh::npos or mesh.trig(mesh.next(mesh.next(halfedge_B))) == HalfedgeMesh::npos) {
             // DO NOTHING
         } else {
             
 
-            real curv_0 = curvature[halfedge_A->vert];
-            real curv_1 = curvature[halfedge_B->vert];
+            real curv_0 = curvature[mesh.vert(halfedge_A)];
+            real curv_1 = curvature[mesh.vert(halfedge_B)];
 
             real L_min_2 = 0.0;
             bool zero_curv = false;
@@ -869,29 +930,29 @@ void collapse_edges (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
 
             if(lengths[k] < L_min_2 or zero_curv) {
 
-                size_t vert_0 = halfedge_A->vert;
-                size_t vert_1 = halfedge_B->vert;
+                size_t vert_0 = mesh.vert(halfedge_A);
+                size_t vert_1 = mesh.vert(halfedge_B);
 
-                if(not (at_boundary(mesh.verts[vert_0]) or at_boundary(mesh.verts[vert_1]))) {
+                if(not (at_boundary(mesh,mesh.verts[vert_0]) or at_boundary(mesh,mesh.verts[vert_1]))) {
 
-                    size_t vert_A = halfedge_A->next->next->vert;
-                    size_t vert_B = halfedge_B->next->next->vert;
+                    size_t vert_A = mesh.vert(mesh.next(mesh.next(halfedge_A)));
+                    size_t vert_B = mesh.vert(mesh.next(mesh.next(halfedge_B)));
 
                     size_t num_paths(0);
 
-                    Halfedge* finder = mesh.verts[vert_0];
-                    Halfedge* init = finder;
+                    Halfedge finder = mesh.verts[vert_0];
+                    Halfedge init = finder;
                     do {
-                        Halfedge* second = finder->next;
-                        Halfedge* second_init = second;
+                        Halfedge second = mesh.next(finder);
+                        Halfedge second_init = second;
                         do {
-                            if(second->next->vert == vert_1) {
+                            if(mesh.vert(mesh.next(second)) == vert_1) {
                                 num_paths++;
                             }
-                            second = second->twin->next;
+                            second = mesh.next(mesh.twin(second));
                         } while(second != second_init);
 
-                        finder = finder->twin->next;
+                        finder = mesh.next(mesh.twin(finder));
                     } while(finder != init);
 
 
@@ -904,15 +965,15 @@ void collapse_edges (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
 
                         double limit_value = 0.8;
 
-                        Halfedge* u(halfedge_A->next->twin);
+                        Halfedge u(mesh.twin(mesh.next(halfedge_A)));
                         do {
-                            if(u == halfedge_B->next->next) {
-                                u = halfedge_B->next->twin;
+                            if(u == mesh.next(mesh.next(halfedge_B))) {
+                                u = mesh.twin(mesh.next(halfedge_B));
                                 old_pos = mesh.vpos[vert_0];
                             }
-                            vec3 a = mesh.vpos[u->vert] - mesh.vpos[u->next->next->vert];
-                            vec3 b = mesh.vpos[u->next->next->vert] - new_pos;
-                            vec3 c = mesh.vpos[u->next->next->vert] - old_pos;
+                            vec3 a = mesh.vpos[mesh.vert(u)] - mesh.vpos[mesh.vert(mesh.next(mesh.next(u)))];
+                            vec3 b = mesh.vpos[mesh.vert(mesh.next(mesh.next(u)))] - new_pos;
+                            vec3 c = mesh.vpos[mesh.vert(mesh.next(mesh.next(u)))] - old_pos;
 
                             c = c.vec(a);
                             c.normalize();
@@ -920,9 +981,9 @@ void collapse_edges (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
                             b.normalize();
 
                             if(b.dot(c)<limit_value) valid = false;
-                            u = u->next->twin;
+                            u = mesh.twin(mesh.next(u));
 
-                        } while(valid and u != halfedge_A->next->next);
+                        } while(valid and u != mesh.next(mesh.next(halfedge_A)));
 
 
                         if(valid) {
@@ -931,28 +992,30 @@ void collapse_edges (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
                             // remove the elements
 
                             // remove the three edges
-                            remove_edge(mesh.edges,halfedge_A->next->edge);
-                            remove_edge(mesh.edges,halfedge_B->next->next->edge);
-                            remove_edge(mesh.edges,halfedge_A->edge);
+                            remove_edge(mesh,mesh.edge(mesh.next(halfedge_A)),scan);
+                            remove_edge(mesh,mesh.edge(mesh.next(mesh.next(halfedge_B))),scan);
+                            remove_edge(mesh,mesh.edge(halfedge_A),scan);
 
-                            swap(lengths[halfedge_A->next->edge],lengths.back());
+                            swap(lengths[mesh.edge(mesh.next(halfedge_A))],lengths.back());
                             lengths.pop_back();
-                            swap(lengths[halfedge_B->next->next->edge],lengths.back());
+                            swap(lengths[mesh.edge(mesh.next(mesh.next(halfedge_B)))],lengths.back());
                             lengths.pop_back();
-                            swap(lengths[halfedge_A->edge],lengths.back());
+                            swap(lengths[mesh.edge(halfedge_A)],lengths.back());
                             lengths.pop_back();
 
 
                             // remove the two faces
-                            remove_face(mesh.trigs,halfedge_A->trig);
-                            remove_face(mesh.trigs,halfedge_B->trig);
+                            remove_face(mesh,mesh.trig(halfedge_A));
+                            remove_face(mesh,mesh.trig(halfedge_B));
 
-                            remove_vertex(mesh.verts,vert_1);
+                            remove_vertex(mesh,vert_1);
 
                             // adjust the real vertices of the mesh
                             mesh.vpos[vert_0] = new_pos;
                             swap(mesh.vpos[vert_1],mesh.vpos.back());
                             mesh.vpos.pop_back();
+                            swap(mesh.origin[vert_1],mesh.origin.back());
+                            mesh.origin.pop_back();
 
                             // and the curvature values
                             curvature[vert_0] = 0.5*(curv_0+curv_1);
@@ -976,52 +1039,52 @@ void collapse_edges (HalfedgeMesh& mesh, vector<real>& curvature, real multiplic
                             }
 
                             // move pointers from vert_1 to vert_0
-                            Halfedge* current = halfedge_A->next;
+                            Halfedge current = mesh.next(halfedge_A);
                             while( current != halfedge_B) {
-                                current->vert = vert_0;
-                                current = current->twin->next;
+                                mesh.vert(current) = vert_0;
+                                current = mesh.next(mesh.twin(current));
                             }
 
                             // make sure that vert_0 has an halfedge index that wont be removed
                             // the same for vert_A and vert_B
-                            mesh.verts[vert_0] = halfedge_A->next->next->twin;
-                            mesh.verts[vert_A] = halfedge_A->next->twin;
-                            mesh.verts[vert_B] = halfedge_B->next->twin;
+                            mesh.verts[vert_0] = mesh.twin(mesh.next(mesh.next(halfedge_A)));
+                            mesh.verts[vert_A] = mesh.twin(mesh.next(halfedge_A));
+                            mesh.verts[vert_B] = mesh.twin(mesh.next(halfedge_B));
 
                             // make sure that the edges of triangle A and B that WEREN'T removed, 
                             // will still have a valid halfedge pointer
-                            mesh.edges[halfedge_A->next->next->edge] = halfedge_A->next->next->twin;
-                            mesh.edges[halfedge_B->next->edge] = halfedge_B->next->twin;
+                            mesh.edges[mesh.edge(mesh.next(mesh.next(halfedge_A)))] = mesh.twin(mesh.next(mesh.next(halfedge_A)));
+                            mesh.edges[mesh.edge(mesh.next(halfedge_B))] = mesh.twin(mesh.next(halfedge_B));
 
                             // now handle twins (before we destroy structure)
-                            halfedge_A->next->next->twin->twin = halfedge_A->next->twin;
-                            halfedge_A->next->twin->twin = halfedge_A->next->next->twin;
-                            halfedge_A->next->twin->edge = halfedge_A->next->next->edge;
+                            mesh.twin(mesh.twin(mesh.next(mesh.next(halfedge_A)))) = mesh.twin(mesh.next(halfedge_A));
+                            mesh.twin(mesh.twin(mesh.next(halfedge_A))) = mesh.twin(mesh.next(mesh.next(halfedge_A)));
+                            mesh.edge(mesh.twin(mesh.next(halfedge_A))) = mesh.edge(mesh.next(mesh.next(halfedge_A)));
 
-                            halfedge_B->next->next->twin->twin = halfedge_B->next->twin;
-                            halfedge_B->next->twin->twin = halfedge_B->next->next->twin;
-                            halfedge_B->next->next->twin->edge = halfedge_B->next->edge;
+                            mesh.twin(mesh.twin(mesh.next(mesh.next(halfedge_B)))) = mesh.twin(mesh.next(halfedge_B));
+                            mesh.twin(mesh.twin(mesh.next(halfedge_B))) = mesh.twin(mesh.next(mesh.next(halfedge_B)));
+                            mesh.edge(mesh.twin(mesh.next(mesh.next(halfedge_B)))) = mesh.edge(mesh.next(halfedge_B));
 
                             // finally remove the halfedges
 
-                            delete halfedge_A->next->next;
-                            delete halfedge_A->next;
-                            delete halfedge_A;
+                            mesh.delete_halfedge(mesh.next(mesh.next(halfedge_A)));
+                            mesh.delete_halfedge(mesh.next(halfedge_A));
+                            mesh.delete_halfedge(halfedge_A);
 
-                            delete halfedge_B->next->next;
-                            delete halfedge_B->next;
-                            delete halfedge_B;
+                            mesh.delete_halfedge(mesh.next(mesh.next(halfedge_B)));
+                            mesh.delete_halfedge(mesh.next(halfedge_B));
+                            mesh.delete_halfedge(halfedge_B);
 
                             // adjust lengths
 
-                            Halfedge* half_0 = mesh.verts[vert_0];
+                            Halfedge half_0 = mesh.verts[vert_0];
                             current = half_0;
                             do {
-                                lengths[current->edge] = (mesh.vpos[current->next->vert]-mesh.vpos[current->vert]).norm2();
-                                current = current->twin->next;
+                                lengths[mesh.edge(current)] = (mesh.vpos[mesh.vert(mesh.next(current))]-mesh.vpos[mesh.vert(current)]).norm2();
+                                current = mesh.next(mesh.twin(current));
                             } while( current != half_0);
 
-                            
+                            scan.touch_neighbourhood(mesh,vert_0);
                             k = 0;
 
                         }
@@ -1073,28 +1136,28 @@ void flip_edges     (HalfedgeMesh& mesh, size_t state) {
     // compute the valence of each vertex (number of neighbouring triangles/edges)
     vector<size_t> valences(mesh.verts.size(),0);
 
-    for(Halfedge* elm : mesh.trigs) {
-        valences[elm->vert]++;
-        valences[elm->next->vert]++;
-        valences[elm->next->next->vert]++;
+    for(Halfedge elm : mesh.trigs) {
+        valences[mesh.vert(elm)]++;
+        valences[mesh.vert(mesh.next(elm))]++;
+        valences[mesh.vert(mesh.next(mesh.next(elm)))]++;
     }
     
 
     size_t num_flipped(0);
     
-    for(Halfedge* halfedge_A : mesh.edges){
+    for(Halfedge halfedge_A : mesh.edges){
 
-        Halfedge* halfedge_B = halfedge_A->twin;
+        Halfedge halfedge_B = mesh.twin(halfedge_A);
 
-        if(halfedge_A->trig == HalfedgeMesh::npos or halfedge_B->trig == HalfedgeMesh::npos) {
+        if(mesh.trig(halfedge_A) == HalfedgeMesh::npos or mesh.trig(halfedge_B) == HalfedgeMesh::npos) {
             // DO NOTHING
         } else {
 
-            size_t vert_0 = halfedge_A->vert;
-            size_t vert_1 = halfedge_B->vert;
+            size_t vert_0 = mesh.vert(halfedge_A);
+            size_t vert_1 = mesh.vert(halfedge_B);
 
-            size_t vert_A = halfedge_A->next->next->vert;
-            size_t vert_B = halfedge_B->next->next->vert;
+            size_t vert_A = mesh.vert(mesh.next(mesh.next(halfedge_A)));
+            size_t vert_B = mesh.vert(mesh.next(mesh.next(halfedge_B)));
             
 
             // if valences are <=3, one must not reduce them further, otherwise
@@ -1104,10 +1167,10 @@ void flip_edges     (HalfedgeMesh& mesh, size_t state) {
                 int cost = 0;
                 int cost_flip = 0;
 
-                bool b0 = at_boundary(mesh.verts[vert_0]);
-                bool b1 = at_boundary(mesh.verts[vert_1]);
-                bool bA = at_boundary(mesh.verts[vert_A]);
-                bool bB = at_boundary(mesh.verts[vert_B]);
+                bool b0 = at_boundary(mesh,mesh.verts[vert_0]);
+                bool b1 = at_boundary(mesh,mesh.verts[vert_1]);
+                bool bA = at_boundary(mesh,mesh.verts[vert_A]);
+                bool bB = at_boundary(mesh,mesh.verts[vert_B]);
 
                 cost += valence_cost(valences[vert_0],b0);
                 cost += valence_cost(valences[vert_1],b1);
@@ -1148,39 +1211,39 @@ void flip_edges     (HalfedgeMesh& mesh, size_t state) {
 
                     // make sure that the vertices 0 and 1 have valid pointers
 
-                    mesh.verts[vert_0] = halfedge_B->next;
-                    mesh.verts[vert_1] = halfedge_A->next;
+                    mesh.verts[vert_0] = mesh.next(halfedge_B);
+                    mesh.verts[vert_1] = mesh.next(halfedge_A);
 
                     // make sure that the triangles A and B have valid pointers
 
-                    mesh.trigs[halfedge_A->trig] = halfedge_A;
-                    mesh.trigs[halfedge_B->trig] = halfedge_B;
+                    mesh.trigs[mesh.trig(halfedge_A)] = halfedge_A;
+                    mesh.trigs[mesh.trig(halfedge_B)] = halfedge_B;
 
                     // flip the edge!
 
-                    // changing the parameters of halfedge_A/B->next->next
+                    // changing the parameters of halfedge_A/mesh.next(mesh.next(B))
 
-                    Halfedge* temp_A = halfedge_A->next->next;
-                    Halfedge* temp_B = halfedge_B->next->next;
+                    Halfedge temp_A = mesh.next(mesh.next(halfedge_A));
+                    Halfedge temp_B = mesh.next(mesh.next(halfedge_B));
 
-                    temp_A->next = halfedge_B->next;
-                    temp_B->next = halfedge_A->next;
+                    mesh.next(temp_A) = mesh.next(halfedge_B);
+                    mesh.next(temp_B) = mesh.next(halfedge_A);
 
-                    // changing the parameters of halfedge_A/B->next
+                    // changing the parameters of halfedge_A/mesh.next(B)
 
-                    halfedge_A->next->next = halfedge_B;
-                    halfedge_A->next->trig = halfedge_B->trig;
+                    mesh.next(mesh.next(halfedge_A)) = halfedge_B;
+                    mesh.trig(mesh.next(halfedge_A)) = mesh.trig(halfedge_B);
 
-                    halfedge_B->next->next = halfedge_A;
-                    halfedge_B->next->trig = halfedge_A->trig;
+                    mesh.next(mesh.next(halfedge_B)) = halfedge_A;
+                    mesh.trig(mesh.next(halfedge_B)) = mesh.trig(halfedge_A);
 
                     // changing the parameters of halfedge_A/B
 
-                    halfedge_A->vert = temp_B->vert;
-                    halfedge_B->vert = temp_A->vert;
+                    mesh.vert(halfedge_A) = mesh.vert(temp_B);
+                    mesh.vert(halfedge_B) = mesh.vert(temp_A);
 
-                    halfedge_A->next = temp_A;
-                    halfedge_B->next = temp_B;
+                    mesh.next(halfedge_A) = temp_A;
+                    mesh.next(halfedge_B) = temp_B;
 
                     num_flipped++;
                 }
@@ -1198,7 +1261,8 @@ void relax_vertices (Mesh& mesh) {
 #ifdef VERBOSE
     cout << "RELAX-VERTICES" << endl;
 #endif   
-    vector<vector<size_t>> neighbours = generate_neighbours(mesh);
+    shared_ptr<const MeshTopology> topo(get_topology(mesh));
+    Adjacency const& neighbours(topo->neighbours);
     vector<vec3> new_vertices(mesh.verts.size());
 
     for(size_t i(0);i<mesh.verts.size();++i) {
@@ -1225,12 +1289,12 @@ void relax_vertices (HalfedgeMesh& mesh) {
         vec3 new_pos;
         real num(0.0);
 
-        Halfedge* u(mesh.verts[i]);
-        Halfedge* v = u;
+        Halfedge u(mesh.verts[i]);
+        Halfedge v = u;
         do {
-            v = v->twin;
-            new_pos += mesh.vpos[v->vert];
-            v = v->next;
+            v = mesh.twin(v);
+            new_pos += mesh.vpos[mesh.vert(v)];
+            v = mesh.next(v);
             num++;
         } while(v != u);
 
@@ -1316,105 +1380,125 @@ bool trace_mesh_positive(Mesh const& mesh,vec3 pos,vec3 dir,vec3& result,size_t&
     return success;
 }
 
-// this funciton projects all vertices of one mesh on the surface defined by
-// the mesh 'other' by applying the function trace_mesh
-void project(Mesh& mesh, Mesh const& other) {
-    // normalized vertex normals
-    vector<vec3> normals = generate_vertex_normals(mesh); // not nice!!
+bool walk_to_intersection(Mesh const& mesh,Adjacency const& triangle_indices,vec3 pos,vec3 dir,size_t seed,vec3& result,size_t& trig_index,size_t max_steps) {
+    size_t const none(-1);
+    size_t j(seed);
+    size_t previous(none);
 
-    size_t n(mesh.verts.size());
+    for(size_t step(0);step<max_steps and j<mesh.trigs.size();++step) {
+        Triplet t(mesh.trigs[j]);
 
-    vector<vec3> new_vertices(n);
+        vec3 a(mesh.verts[t.b]-mesh.verts[t.a]);
+        vec3 b(mesh.verts[t.c]-mesh.verts[t.b]);
+        vec3 c(mesh.verts[t.a]-mesh.verts[t.c]);
 
-    omp_set_num_threads(100);
+        vec3 n(a.vec(b));
 
-    #pragma omp parallel
-    {
+        real s = n.dot(mesh.verts[t.a]-pos)/n.dot(dir);
 
-    Mesh local_mesh,local_other;
-    vector<vec3> local_normals;
+        vec3 x = pos + s*dir;
 
-    #pragma omp critical 
-    {
-        local_mesh = mesh;
-        local_other = other;
-        local_normals = normals;
+        // the edge (p,q) behind which x lies
+        size_t p, q;
+        if(not ((mesh.verts[t.a]-x).vec(a).dot(n) >= 0)) {
+            p = t.a; q = t.b;
+        } else if(not ((mesh.verts[t.b]-x).vec(b).dot(n) >= 0)) {
+            p = t.b; q = t.c;
+        } else if(not ((mesh.verts[t.c]-x).vec(c).dot(n) >= 0)) {
+            p = t.c; q = t.a;
+        } else {
+            result = x;
+            trig_index = j;
+            return true;
+        }
+
+        // the other triangle at the edge (p,q)
+        size_t neighbour(none);
+        for(size_t k : triangle_indices[p]) {
+            if(k == j) continue;
+            for(size_t l : triangle_indices[q]) {
+                if(k == l) neighbour = k;
+            }
+        }
+        // stop at boundaries or if the walk goes back and forth
+        if(neighbour == none or neighbour == previous) return false;
+
+        previous = j;
+        j = neighbour;
     }
+    return false;
+}
 
+// this funciton projects all vertices of one mesh on the surface defined by
+// the mesh 'other' by applying the function trace_mesh. The threads only read the
+// meshes and each writes its own vertices, so no copies or locks are needed.
+void project(Mesh& mesh, Mesh const& other, size_t num_threads) {
+    // normalized vertex normals
+    vector<vec3> normals = generate_vertex_normals(mesh); // not nice!!
 
-    #pragma omp for
-    for(size_t i = 0;i<n;++i) {
+    size_t n(mesh.verts.size());
 
-        vec3 projected_pos;
+    vector<vec3> new_vertices(n);
 
-        size_t index(0); // dummy variable
+    // bounding volume hierarchy for tracing the rays
+    MeshBVH bvh(other);
 
-        trace_mesh(local_other,local_mesh.verts[i],local_normals[i],projected_pos,index);
+    omp_set_num_threads(num_threads);
 
-        #pragma omp critical
-        new_vertices[i] = projected_pos;
-    }
+    #pragma omp parallel for
+    for(size_t i = 0;i<n;++i) {
+
+        size_t index(0); // dummy variable
 
+        bvh.trace(mesh.verts[i],normals[i],new_vertices[i],index);
     }
 
-    mesh.verts.clear();
-    mesh.verts = new_vertices;
+    mesh.verts.swap(new_vertices);
 }
 
 // same function as above, but starting from origin and setting tracing-attempts without
-// result to zero.
-void project_from_origin(std::vector<vec3>& normals, Mesh const& other, real const& dist_to_wall) {
+// result to zero. each thread only reads and overwrites its own entries of normals.
+void project_from_origin(std::vector<vec3>& normals, Mesh const& other, real const& dist_to_wall, size_t num_threads) {
     
     size_t n(normals.size());
 
-    omp_set_num_threads(100);
-
-    #pragma omp parallel
-    {
+    // bounding volume hierarchy for tracing the rays
+    MeshBVH bvh(other);
 
-    Mesh local_other;
-    vector<vec3> local_normals;
-
-    #pragma omp critical 
-    {
-        local_normals = normals;
-        local_other = other;
-    }
+    // exceptions must not leave the parallel region, so the failure is only recorded there
+    bool failed(false);
 
+    omp_set_num_threads(num_threads);
 
-    #pragma omp for
+    #pragma omp parallel for
     for(size_t i = 0;i<n;++i) {
 
         vec3 projected_pos;
 
         size_t index(0); // dummmy variable
 
-        bool found = trace_mesh_positive(local_other,vec3(),local_normals[i],projected_pos,index);
+        bool found = bvh.trace_positive(vec3(),normals[i],projected_pos,index);
 
-        #pragma omp critical 
-        {
-        
         if(found) {
             normals[i] = projected_pos;
         } else {
-            if(local_normals[i].z == 0.0) { // this case should not happen
+            if(normals[i].z == 0.0) { // this case should not happen
                 //normals[i] = vec3();
-                throw(out_of_range("x coordinate must not be zero!"));
+                #pragma omp atomic write
+                failed = true;
             } else {
-                normals[i] = local_normals[i]*(-dist_to_wall/local_normals[i].z);
+                normals[i] = normals[i]*(-dist_to_wall/normals[i].z);
             }
             
         }
-
-        }
     }
 
-    }
+    if(failed) throw(out_of_range("x coordinate must not be zero!"));
 }
 
 
-void project_and_interpolate(Mesh& mesh, vector<real>& f_res, Mesh const& other, vector<real> const& f) {
-    project_and_interpolate(mesh,generate_vertex_normals(mesh),f_res,other,f);
+void project_and_interpolate(Mesh& mesh, vector<real>& f_res, Mesh const& other, vector<real> const& f, size_t num_threads) {
+    project_and_interpolate(mesh,generate_vertex_normals(mesh),f_res,other,f,num_threads);
 }
 
 // with this function we can not only project one mesh on another, but also get the interpolated
@@ -1423,60 +1507,53 @@ void project_and_interpolate(Mesh& mesh, vector<real>& f_res, Mesh const& other,
 // 'other', but on a local polynomial fit of the vertices of this mesh. This leads to a smoother 
 // surface, especially in the case where the vertex density is locally much higher on the new mesh 
 // than on the mesh 'other'.
-void project_and_interpolate(Mesh& mesh,vector<vec3> const& vertex_normals, vector<real>& f_res, Mesh const& other, vector<real> const& f) {
+void project_and_interpolate(Mesh& mesh,vector<vec3> const& vertex_normals, vector<real>& f_res, Mesh const& other, vector<real> const& f, size_t num_threads) {
+    vector<vector<real>> results;
+    project_and_interpolate(mesh,vertex_normals,results,other,vector<vector<real>>{f},vector<size_t>(),num_threads);
+    f_res = results[0];
+}
+
+// the same for several functions f[k] on 'other' at once (they share the projection)
+void project_and_interpolate(Mesh& mesh,vector<vec3> const& vertex_normals, vector<vector<real>>& f_res, Mesh const& other, vector<vector<real>> const& f, vector<size_t> const& seed_trigs, size_t num_threads) {
 #ifdef VERBOSE
     cout << "PROJECT-AND-INTERPOLATE" << endl;
 #endif
-    assert(f.size() == other.verts.size());
-    vector<real> result(mesh.verts.size());
+    assert(all_of(f.begin(),f.end(),[&other](vector<real> const& f_k) { return f_k.size() == other.verts.size(); }));
+    assert(seed_trigs.empty() or seed_trigs.size() == mesh.verts.size());
+    vector<vector<real>> result(f.size(),vector<real>(mesh.verts.size()));
 
     // normalized vertex normals
-    vector<vec3> normals = vertex_normals;
+    vector<vec3> const& normals = vertex_normals;
 
     vector<vec3> new_vertices(mesh.verts.size());
 
     // creating surface fits for each vertex of 'other'
     vector<vec3> other_normals = generate_vertex_normals(other);
-    vector<vector<size_t>> verts = generate_neighbours(other); // alternatively generate_2_ring();
-    vector<FittingTool> fits(other.verts.size());
-    for(size_t i(0);i<other.verts.size();++i) {
-        vector<vec3> positions;
-        positions.push_back(other.verts[i]);
-        for(size_t j : verts[i])
-            positions.push_back(other.verts[j]);
+    shared_ptr<const MeshTopology> topo(get_topology(other));
+    QuadraticFits fits;
+    compute_quadratic_fits(fits,other,other_normals,topo->neighbours,num_threads); // alternatively topo->two_ring
 
-        fits[i].compute_quadratic_fit(other_normals[i],other.verts[i],positions);
-    }
+    // bounding volume hierarchy for tracing the rays
+    MeshBVH bvh(other);
 
-    omp_set_num_threads(100);
+    // the threads share the (read only) meshes, normals and fits, and write to their own
+    // entries of new_vertices and result only
+    omp_set_num_threads(num_threads);
 
-    #pragma omp parallel
-    {
-
-    Mesh local_mesh,local_other;
-    vector<vec3> local_normals;
-    vector<vec3> local_other_normals;
-
-    #pragma omp critical 
-    {
-        local_mesh = mesh;
-        local_other = other;
-        local_normals = normals;
-        local_other_normals = other_normals;
-    }
-
-    size_t n(local_mesh.verts.size());
+    size_t n(mesh.verts.size());
 
-    #pragma omp for
+    #pragma omp parallel for
     for(size_t i = 0;i<n;++i) {
 
         vec3 projected_pos;
 
         size_t index(0);
 
-        trace_mesh(local_other,local_mesh.verts[i],local_normals[i],projected_pos,index);
+        // the hit next to the seed triangle (if given), the bvh is only needed if the walk fails
+        if(seed_trigs.empty() or not walk_to_intersection(other,topo->triangle_indices,mesh.verts[i],normals[i],seed_trigs[i],projected_pos,index))
+            bvh.trace(mesh.verts[i],normals[i],projected_pos,index);
 
-        Triplet t = local_other.trigs[index];
+        Triplet t = other.trigs[index];
 
         // copy coord system of the three fits at the three edges.
         // using transform, and then get_position to obtain the projection on the 
@@ -1484,29 +1561,14 @@ void project_and_interpolate(Mesh& mesh,vector<vec3> const& vertex_normals, vect
         // for averaging the positions obtained through the three fits.
 
 ///* temporarily out for testing purposes!
-        FittingTool A,B,C;
-        #pragma omp critical 
-        {
-            A = fits[t.a];
-            B = fits[t.b];
-            C = fits[t.c];
-        }
-
-
-
-        CoordSystem Sa,Sb,Sc;
-        Sa = A.copy_coord_system();
-        Sb = B.copy_coord_system();
-        Sc = C.copy_coord_system();
-
         vec3 Pa,Pb,Pc;
-        Pa = Sa.transform(projected_pos);
-        Pb = Sb.transform(projected_pos);
-        Pc = Sc.transform(projected_pos);
+        Pa = fits.systems[t.a].transform(projected_pos);
+        Pb = fits.systems[t.b].transform(projected_pos);
+        Pc = fits.systems[t.c].transform(projected_pos);
 
-        Pa = A.get_position(Pa.x,Pa.y);
-        Pb = B.get_position(Pb.x,Pb.y);
-        Pc = C.get_position(Pc.x,Pc.y);
+        Pa = fits.get_position(t.a,Pa.x,Pa.y);
+        Pb = fits.get_position(t.b,Pb.x,Pb.y);
+        Pc = fits.get_position(t.c,Pc.x,Pc.y);
 //*/
 
         // now we want to determine the coordinates of projected_pos
@@ -1516,15 +1578,15 @@ void project_and_interpolate(Mesh& mesh,vector<vec3> const& vertex_normals, vect
         // the fitting functions.
 
         // build local 2d coord system
-        vec3 u(local_other.verts[t.b]-local_other.verts[t.a]);
+        vec3 u(other.verts[t.b]-other.verts[t.a]);
         u.normalize();
-        vec3 v(local_other.verts[t.c]-local_other.verts[t.b]);
+        vec3 v(other.verts[t.c]-other.verts[t.b]);
         v = v - v.dot(u)*u;
         v.normalize();
 
-        vec3 a(local_other.verts[t.b]-local_other.verts[t.a]);
-        vec3 b(local_other.verts[t.c]-local_other.verts[t.b]);
-        vec3 x(projected_pos         -local_other.verts[t.a]);
+        vec3 a(other.verts[t.b]-other.verts[t.a]);
+        vec3 b(other.verts[t.c]-other.verts[t.b]);
+        vec3 x(projected_pos         -other.verts[t.a]);
 
         real a0,a1,b0,b1,x0,x1,q,r;
 
@@ -1541,24 +1603,18 @@ void project_and_interpolate(Mesh& mesh,vector<vec3> const& vertex_normals, vect
 
         projected_pos = (1.0 - q)*Pa + (q - r)*Pb + r*Pc; // this one too temporarily out
 
-        #pragma omp critical 
-        {
-            new_vertices[i] = projected_pos;
-            result[i] = (1.0 - q)*f[t.a] + (q - r)*f[t.b] + r*f[t.c];
-        }
-    }
-
+        new_vertices[i] = projected_pos;
+        for(size_t k(0);k<f.size();++k)
+            result[k][i] = (1.0 - q)*f[k][t.a] + (q - r)*f[k][t.b] + r*f[k][t.c];
     }
 
-    mesh.verts.clear();
-    mesh.verts = new_vertices;
+    mesh.verts.swap(new_vertices);
 
-    f_res.clear();
-    f_res = result;
+    f_res.swap(result);
 }
 
 
-void project_and_interpolate(Mesh& mesh,vector<vec3> const& vertex_normals, vector<real>& f_res, vector<real>& f_2_res, Mesh const& other, vector<real> const& f, vector<real> const& f_2) {
+void project_and_interpolate(Mesh& mesh,vector<vec3> const& vertex_normals, vector<real>& f_res, vector<real>& f_2_res, Mesh const& other, vector<real> const& f, vector<real> const& f_2, size_t num_threads) {
 #ifdef VERBOSE
     cout << "PROJECT-AND-INTERPOLATE" << endl;
 #endif
@@ -1567,51 +1623,32 @@ void project_and_interpolate(Mesh& mesh,vector<vec3> const& vertex_normals, vect
     vector<real> result_2(mesh.verts.size());
 
     // normalized vertex normals
-    vector<vec3> normals = vertex_normals;
+    vector<vec3> const& normals = vertex_normals;
 
     vector<vec3> new_vertices(mesh.verts.size());
 
-    // creating surface fits for each vertex of 'other'
-    vector<vec3> other_normals = generate_vertex_normals(other);
-    vector<vector<size_t>> verts = generate_neighbours(other); // alternatively generate_2_ring();
-    vector<FittingTool> fits(other.verts.size());
-    for(size_t i(0);i<other.verts.size();++i) {
-        vector<vec3> positions;
-        positions.push_back(other.verts[i]);
-        for(size_t j : verts[i])
-            positions.push_back(other.verts[j]);
-        fits[i].compute_quadratic_fit(other_normals[i],other.verts[i],positions);
-    }
-
-    omp_set_num_threads(100);
+    // the vertices are projected on the flat triangles here, so no surface fits are needed (see the
+    // block that is commented out below, it would need the fits of the other overload)
 
-    #pragma omp parallel
-    {
+    // bounding volume hierarchy for tracing the rays
+    MeshBVH bvh(other);
 
-    Mesh local_mesh,local_other;
-    vector<vec3> local_normals;
-    vector<vec3> local_other_normals;
-
-    #pragma omp critical 
-    {
-        local_mesh = mesh;
-        local_other = other;
-        local_normals = normals;
-        local_other_normals = other_normals;
-    }
+    // the threads share the (read only) meshes and normals, and write to their own
+    // entries of new_vertices and result only
+    omp_set_num_threads(num_threads);
 
-    size_t n(local_mesh.verts.size());
+    size_t n(mesh.verts.size());
 
-    #pragma omp for
+    #pragma omp parallel for
     for(size_t i = 0;i<n;++i) {
 
         vec3 projected_pos;
 
         size_t index(0);
 
-        trace_mesh(local_other,local_mesh.verts[i],local_normals[i],projected_pos,index);
+        bvh.trace(mesh.verts[i],normals[i],projected_pos,index);
 
-        Triplet t = local_other.trigs[index];
+        Triplet t = other.trigs[index];
 
         // copy coord system of the three fits at the three edges.
         // using transform, and then get_position to obtain the projection on the 
@@ -1619,29 +1656,14 @@ void project_and_interpolate(Mesh& mesh,vector<vec3> const& vertex_normals, vect
         // for averaging the positions obtained through the three fits.
 
 /* temporarily out for testing purposes!
-        FittingTool A,B,C;
-        #pragma omp critical 
-        {
-            A = fits[t.a];
-            B = fits[t.b];
-            C = fits[t.c];
-        }
-
-
-
-        CoordSystem Sa,Sb,Sc;
-        Sa = A.copy_coord_system();
-        Sb = B.copy_coord_system();
-        Sc = C.copy_coord_system();
-
         vec3 Pa,Pb,Pc;
-        Pa = Sa.transform(projected_pos);
-        Pb = Sb.transform(projected_pos);
-        Pc = Sc.transform(projected_pos);
+        Pa = fits.systems[t.a].transform(projected_pos);
+        Pb = fits.systems[t.b].transform(projected_pos);
+        Pc = fits.systems[t.c].transform(projected_pos);
 
-        Pa = A.get_position(Pa.x,Pa.y);
-        Pb = B.get_position(Pb.x,Pb.y);
-        Pc = C.get_position(Pc.x,Pc.y);
+        Pa = fits.get_position(t.a,Pa.x,Pa.y);
+        Pb = fits.get_position(t.b,Pb.x,Pb.y);
+        Pc = fits.get_position(t.c,Pc.x,Pc.y);
 */
 
         // now we want to determine the coordinates of projected_pos
@@ -1651,15 +1673,15 @@ void project_and_interpolate(Mesh& mesh,vector<vec3> const& vertex_normals, vect
         // the fitting functions.
 
         // build local 2d coord system
-        vec3 u(local_other.verts[t.b]-local_other.verts[t.a]);
+        vec3 u(other.verts[t.b]-other.verts[t.a]);
         u.normalize();
-        vec3 v(local_other.verts[t.c]-local_other.verts[t.b]);
+        vec3 v(other.verts[t.c]-other.verts[t.b]);
         v = v - v.dot(u)*u;
         v.normalize();
 
-        vec3 a(local_other.verts[t.b]-local_other.verts[t.a]);
-        vec3 b(local_other.verts[t.c]-local_other.verts[t.b]);
-        vec3 x(projected_pos         -local_other.verts[t.a]);
+        vec3 a(other.verts[t.b]-other.verts[t.a]);
+        vec3 b(other.verts[t.c]-other.verts[t.b]);
+        vec3 x(projected_pos         -other.verts[t.a]);
 
         real a0,a1,b0,b1,x0,x1,q,r;
 
@@ -1676,28 +1698,21 @@ void project_and_interpolate(Mesh& mesh,vector<vec3> const& vertex_normals, vect
 
         // projected_pos = (1.0 - q)*Pa + (q - r)*Pb + r*Pc; // this one too temporarily out
 
-        #pragma omp critical 
-        {
-            new_vertices[i] = projected_pos;
-            result[i] = (1.0 - q)*f[t.a] + (q - r)*f[t.b] + r*f[t.c];
-            result_2[i] = (1.0 - q)*f_2[t.a] + (q - r)*f_2[t.b] + r*f_2[t.c];
-        }
-    }
-
+        new_vertices[i] = projected_pos;
+        result[i] = (1.0 - q)*f[t.a] + (q - r)*f[t.b] + r*f[t.c];
+        result_2[i] = (1.0 - q)*f_2[t.a] + (q - r)*f_2[t.b] + r*f_2[t.c];
     }
 
-    mesh.verts.clear();
-    mesh.verts = new_vertices;
+    mesh.verts.swap(new_vertices);
 
-    f_res.clear();
-    f_res = result;
-    f_2_res.clear();
-    f_2_res = result_2;
+    f_res.swap(result);
+    f_2_res.swap(result_2);
 }
 
 Mesh l2smooth(Mesh mesh,vector<size_t> const& vert_inds) {
     vector<vec3> normals = generate_vertex_normals(mesh);
-    vector<vector<size_t>> ring = generate_2_ring(mesh);
+    shared_ptr<const MeshTopology> topo(get_topology(mesh));
+    Adjacency const& ring(topo->two_ring);
     vector<vec3> copy = mesh.verts;
     for(size_t i : vert_inds) {
         vector<vec3> positions;
@@ -1731,7 +1746,8 @@ Mesh l2smooth(Mesh mesh, std::vector<real>& pot) {
 
 Mesh l2smooth(Mesh mesh, std::vector<real>& pot, std::vector<size_t> const& vert_inds) {
     vector<vec3> normals = generate_vertex_normals(mesh);
-    vector<vector<size_t>> ring = generate_2_ring(mesh);
+    shared_ptr<const MeshTopology> topo(get_topology(mesh));
+    Adjacency const& ring(topo->two_ring);
     vector<vec3> copy = mesh.verts;
     vector<real> copy_pot = pot;
     for(size_t i : vert_inds) {
@@ -3,6 +3,7 @@
 
 #include "Mesh.hpp"
 #include "HalfedgeMesh.hpp"
+#include "MeshBVH.hpp"
 
 namespace Bem {
 
@@ -11,6 +12,10 @@ namespace Bem {
 // collapse_edges further add resp. remove elements from the mesh. relax_vertices is a smoothing
 // function that only displaces vertices. the second group of functions are needed for projecting
 // a mesh along its normals on another mesh and interpolating vertex data from the other mesh.
+// trace_mesh and trace_mesh_positive test all triangles of the mesh; the projection functions
+// trace with a MeshBVH of the other mesh instead (same results). If a seed triangle of the other mesh
+// close to each vertex is known (e.g. from HalfedgeMesh::origin after remeshing), walk_to_intersection
+// finds the hit in its neighbourhood and the MeshBVH is only used if the walk fails.
 
 void split_edges    (HalfedgeMesh& mesh, real L_max);
 void split_edges    (HalfedgeMesh& mesh, std::vector<real>& curvature, real multiplicator);
@@ -22,11 +27,18 @@ void relax_vertices (HalfedgeMesh& mesh);
 
 bool trace_mesh(Mesh const& mesh,vec3 pos,vec3 dir,vec3& result,size_t& trig_index);
 bool trace_mesh_positive(Mesh const& mesh,vec3 pos,vec3 dir,vec3& result,size_t& trig_index);
-void project(Mesh& mesh, Mesh const& other);
-void project_from_origin(std::vector<vec3>& normals, Mesh const& other, real const& dist_to_wall);
-void project_and_interpolate(Mesh& mesh, std::vector<real>& f_res, Mesh const& other, std::vector<real> const& f);
-void project_and_interpolate(Mesh& mesh, std::vector<vec3> const& vertex_normals, std::vector<real>& f_res, Mesh const& other, std::vector<real> const& f);
-void project_and_interpolate(Mesh& mesh, std::vector<vec3> const& vertex_normals, std::vector<real>& f_res, std::vector<real>& f_2_res, Mesh const& other, std::vector<real> const& f, std::vector<real> const& f_2);
+// walks from the triangle seed over the neighbouring triangles (across the edge the intersection lies
+// behind) until it finds the triangle containing the intersection of the line pos + s*dir with its plane.
+// returns false if there is none within max_steps triangles (or the walk reaches a boundary). The hit is
+// the local one, which is the same as the one of trace_mesh unless other parts of the mesh are closer.
+bool walk_to_intersection(Mesh const& mesh,Adjacency const& triangle_indices,vec3 pos,vec3 dir,size_t seed,vec3& result,size_t& trig_index,size_t max_steps = 16);
+// the projections run on num_threads OpenMP threads (the simulations pass their own num_threads)
+void project(Mesh& mesh, Mesh const& other, size_t num_threads = 100);
+void project_from_origin(std::vector<vec3>& normals, Mesh const& other, real const& dist_to_wall, size_t num_threads = 100);
+void project_and_interpolate(Mesh& mesh, std::vector<real>& f_res, Mesh const& other, std::vector<real> const& f, size_t num_threads = 100);
+void project_and_interpolate(Mesh& mesh, std::vector<vec3> const& vertex_normals, std::vector<real>& f_res, Mesh const& other, std::vector<real> const& f, size_t num_threads = 100);
+void project_and_interpolate(Mesh& mesh, std::vector<vec3> const& vertex_normals, std::vector<std::vector<real>>& f_res, Mesh const& other, std::vector<std::vector<real>> const& f, std::vector<size_t> const& seed_trigs = std::vector<size_t>(), size_t num_threads = 100);
+void project_and_interpolate(Mesh& mesh, std::vector<vec3> const& vertex_normals, std::vector<real>& f_res, std::vector<real>& f_2_res, Mesh const& other, std::vector<real> const& f, std::vector<real> const& f_2, size_t num_threads = 100);
 
 Mesh l2smooth(Mesh mesh);
 Mesh l2smooth(Mesh mesh, std::vector<size_t> const& vert_inds);
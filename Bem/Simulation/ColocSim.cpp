@@ -1,17 +1,16 @@
 #include "ColocSim.hpp"
 #include "../Integration/Integrator.hpp"
+#include "../Integration/MultipoleTree.hpp"
+#include "../Integration/HMatrix.hpp"
+#include "MatrixFreeOperator.hpp"
+#include "TiledLU.hpp"
 #include <vector>
-#include <omp.h>
-
-
-#ifdef VERBOSE
+#include <memory>
 #include <chrono>
-#endif
+#include <omp.h>
 
 using namespace std;
-#ifdef VERBOSE
 using namespace chrono;
-#endif
 
 namespace Bem {
 
@@ -26,16 +25,26 @@ void ColocSim::assemble_matrices(Eigen::MatrixXd& G,Eigen::MatrixXd& H, Mesh con
     G = Eigen::MatrixXd::Zero(m.verts.size(),m.verts.size());
     H = Eigen::MatrixXd::Zero(m.verts.size(),m.verts.size());
 
+    const size_t block_size(128);
+    const size_t num_blocks((m.verts.size() + block_size - 1)/block_size);
+
+#if LINEAR
+    // quadrature points of all triangles, shared by all threads
+    const TriangleCache cache(inter.make_triangle_cache(m.verts,m.trigs));
+#endif
+
+    const CoordVec& x(m.verts);
+    const CoordVec n(generate_vertex_normals(m));
+    const PointsSoA points(x);
+
     omp_set_num_threads(num_threads);
+    work.reserve_scratch(omp_get_max_threads(),m.verts.size());
 
     #pragma omp parallel
     {
     
-    Mesh local(m);
-    const CoordVec& x(local.verts);
-    const CoordVec n(generate_vertex_normals(local));
-    size_t N(local.verts.size());
-    size_t M(local.trigs.size());
+    size_t N(m.verts.size());
+    size_t M(m.trigs.size());
     Integrator int_local(inter);
 
 #ifdef VERBOSE
@@ -46,36 +55,39 @@ void ColocSim::assemble_matrices(Eigen::MatrixXd& G,Eigen::MatrixXd& H, Mesh con
     }
 #endif
     
-    #pragma omp for
-    for(size_t j = 0;j<M;++j) {
-        Eigen::MatrixXd G_loc = Eigen::MatrixXd::Zero(N,3);
-        Eigen::MatrixXd H_loc = Eigen::MatrixXd::Zero(N,3);
-        const Triplet trip(local.trigs[j]);
-        
-        for(size_t i(0);i<N;++i) {
-#if LINEAR
-    #if MIRROR_MESH
-            int_local.integrate_Lin_coloc_local_mir(x,i,trip,G_loc,H_loc);
-    #else
-            int_local.integrate_Lin_coloc_local(x,i,trip,G_loc,H_loc);
+    // Each thread computes the rows of a block of colocation points for all triangles, such that
+    // the threads write to disjoint parts of G and H. The contributions of the triangles are added
+    // to each matrix element in the same order for any number of threads (reproducible results).
+    Eigen::MatrixXd& G_loc(work.G_loc[omp_get_thread_num()]);
+    Eigen::MatrixXd& H_loc(work.H_loc[omp_get_thread_num()]);
+    vector<size_t>& batch_scratch(work.batch_scratch[omp_get_thread_num()]);
 
-    #endif
+    #pragma omp for schedule(dynamic)
+    for(size_t b = 0;b<num_blocks;++b) {
+        size_t begin(b*block_size);
+        size_t end(min(N,begin+block_size));
+
+        for(size_t j(0);j<M;++j) {
+            const Triplet trip(m.trigs[j]);
+#if LINEAR
+            int_local.integrate_Lin_coloc_batch(x,points,cache,begin,end,j,MIRROR_MESH,G_loc,H_loc,batch_scratch);
 #else
-            int_local.integrate_Lin_coloc_local_cubic(x,n,i,trip,G_loc,H_loc);
+            for(size_t i(begin);i<end;++i) {
+                int_local.integrate_Lin_coloc_local_cubic(x,n,i,trip,G_loc,H_loc);
+            }
 #endif
+            for(size_t k(0);k<3;++k) {
+                G.col(trip[k]).segment(begin,end-begin) += G_loc.col(k).segment(begin,end-begin);
+                H.col(trip[k]).segment(begin,end-begin) += H_loc.col(k).segment(begin,end-begin);
+                G_loc.col(k).segment(begin,end-begin).setZero();
+                H_loc.col(k).segment(begin,end-begin).setZero();
+            }
         }
 
 #ifdef VERBOSE
         if(omp_get_thread_num() == 0)
-            cout << " Assembling matrices... progress (approx.): " << float(j+1)/M*100.0*omp_get_num_threads() << "%                                    \r" << flush;
+            cout << " Assembling matrices... progress (approx.): " << float(b+1)/num_blocks*100.0*omp_get_num_threads() << "%                                    \r" << flush;
 #endif
-        #pragma omp critical 
-        {
-        for(size_t k(0);k<3;++k) {
-            G.col(trip[k]) += G_loc.col(k);
-            H.col(trip[k]) += H_loc.col(k);
-        }
-        }   
     }
     }
 
@@ -109,4 +121,215 @@ void ColocSim::assemble_matrices(Eigen::MatrixXd& G,Eigen::MatrixXd& H, Mesh con
 #endif
 }
 
-} // namespace Bem
\ No newline at end of file
+// Same as assemble_matrices, but the columns of H are multiplied with phi right away: each thread adds
+// the contributions of its block of colocation points to H_phi (and the row sums of H, needed for the
+// solid angle term, to H_one). This saves the memory of H and the product H*phi.
+void ColocSim::assemble_matrix_product(Eigen::MatrixXd& G,Eigen::VectorXd& H_phi, Mesh const& m,Eigen::VectorXd const& phi) const {
+#ifdef VERBOSE
+    auto start = high_resolution_clock::now();
+#endif
+
+    G = Eigen::MatrixXd::Zero(m.verts.size(),m.verts.size());
+    H_phi = Eigen::VectorXd::Zero(m.verts.size());
+    Eigen::VectorXd H_one = Eigen::VectorXd::Zero(m.verts.size());
+
+    const size_t block_size(128);
+    const size_t num_blocks((m.verts.size() + block_size - 1)/block_size);
+
+#if LINEAR
+    const TriangleCache cache(inter.make_triangle_cache(m.verts,m.trigs));
+#endif
+
+    const CoordVec& x(m.verts);
+    const CoordVec n(generate_vertex_normals(m));
+    const PointsSoA points(x);
+
+    omp_set_num_threads(num_threads);
+    work.reserve_scratch(omp_get_max_threads(),m.verts.size());
+
+    #pragma omp parallel
+    {
+
+    size_t N(m.verts.size());
+    size_t M(m.trigs.size());
+    Integrator int_local(inter);
+
+    Eigen::MatrixXd& G_loc(work.G_loc[omp_get_thread_num()]);
+    Eigen::MatrixXd& H_loc(work.H_loc[omp_get_thread_num()]);
+    vector<size_t>& batch_scratch(work.batch_scratch[omp_get_thread_num()]);
+
+    #pragma omp for schedule(dynamic)
+    for(size_t b = 0;b<num_blocks;++b) {
+        size_t begin(b*block_size);
+        size_t end(min(N,begin+block_size));
+
+        for(size_t j(0);j<M;++j) {
+            const Triplet trip(m.trigs[j]);
+#if LINEAR
+            int_local.integrate_Lin_coloc_batch(x,points,cache,begin,end,j,MIRROR_MESH,G_loc,H_loc,batch_scratch);
+#else
+            for(size_t i(begin);i<end;++i) {
+                int_local.integrate_Lin_coloc_local_cubic(x,n,i,trip,G_loc,H_loc);
+            }
+#endif
+            for(size_t k(0);k<3;++k) {
+                G.col(trip[k]).segment(begin,end-begin) += G_loc.col(k).segment(begin,end-begin);
+                H_phi.segment(begin,end-begin) += phi(trip[k])*H_loc.col(k).segment(begin,end-begin);
+                H_one.segment(begin,end-begin) += H_loc.col(k).segment(begin,end-begin);
+                G_loc.col(k).segment(begin,end-begin).setZero();
+                H_loc.col(k).segment(begin,end-begin).setZero();
+            }
+        }
+    }
+    }
+
+    // solid angle term, see assemble_matrices
+#if LINEAR
+    H_phi -= ((4.0*M_PI + H_one.array())*phi.array()).matrix();
+#else
+    H_phi -= 2.0*M_PI*phi;
+#endif
+
+#ifdef VERBOSE
+    auto end = high_resolution_clock::now();
+    cout << "used time = " << duration_cast<duration<double>>(end-start).count() << " s. " << endl;
+#endif
+}
+
+// The blocks of colocation rows of assemble_matrix_product are the column panels of G^T, so the TiledLU
+// factorizes G^T: the panels are assembled by OpenMP tasks (into the transposed position) and the
+// factorization tasks of a panel only wait for its assembly and the previous panels. The integration
+// and the factorization of the first panels thus overlap instead of running one after the other.
+Eigen::VectorXd ColocSim::solve_pipelined(Mesh const& m,Eigen::VectorXd const& phi) const {
+    auto start = high_resolution_clock::now();
+
+    size_t N(m.verts.size());
+    size_t M(m.trigs.size());
+    TiledLU& lu(work.lu);
+    lu.resize(N);
+    Eigen::MatrixXd& G_T(lu.matrix());
+    G_T.setZero();
+    Eigen::VectorXd H_phi = Eigen::VectorXd::Zero(N);
+    Eigen::VectorXd H_one = Eigen::VectorXd::Zero(N);
+
+#if LINEAR
+    const TriangleCache cache(inter.make_triangle_cache(m.verts,m.trigs));
+#endif
+    const CoordVec& x(m.verts);
+    const CoordVec n(generate_vertex_normals(m));
+    const PointsSoA points(x);
+
+    // integrator of each thread, created by the first task running on it
+    omp_set_num_threads(num_threads);
+    vector<unique_ptr<Integrator>> integrators(omp_get_max_threads());
+    work.reserve_scratch(omp_get_max_threads(),N);
+
+    auto assemble = [&](size_t b) {
+        size_t t(omp_get_thread_num());
+        if(not integrators[t]) integrators[t].reset(new Integrator(inter));
+        Integrator& int_local(*integrators[t]);
+        Eigen::MatrixXd& G_loc(work.G_loc[t]);
+        Eigen::MatrixXd& H_loc(work.H_loc[t]);
+        vector<size_t>& batch_scratch(work.batch_scratch[t]);
+
+        size_t begin(lu.panel_begin(b));
+        size_t end(lu.panel_end(b));
+
+        for(size_t j(0);j<M;++j) {
+            const Triplet trip(m.trigs[j]);
+#if LINEAR
+            int_local.integrate_Lin_coloc_batch(x,points,cache,begin,end,j,MIRROR_MESH,G_loc,H_loc,batch_scratch);
+#else
+            for(size_t i(begin);i<end;++i) {
+                int_local.integrate_Lin_coloc_local_cubic(x,n,i,trip,G_loc,H_loc);
+            }
+#endif
+            for(size_t k(0);k<3;++k) {
+                G_T.row(trip[k]).segment(begin,end-begin) += G_loc.col(k).segment(begin,end-begin).transpose();
+                H_phi.segment(begin,end-begin) += phi(trip[k])*H_loc.col(k).segment(begin,end-begin);
+                H_one.segment(begin,end-begin) += H_loc.col(k).segment(begin,end-begin);
+                G_loc.col(k).segment(begin,end-begin).setZero();
+                H_loc.col(k).segment(begin,end-begin).setZero();
+            }
+        }
+    };
+
+    lu.factorize(assemble,num_threads);
+    auto factorized = high_resolution_clock::now();
+
+    // solid angle term, see assemble_matrices
+#if LINEAR
+    H_phi -= ((4.0*M_PI + H_one.array())*phi.array()).matrix();
+#else
+    H_phi -= 2.0*M_PI*phi;
+#endif
+
+    Eigen::VectorXd psi_new = lu.solve_transposed(H_phi);
+    if(warm_start) psi_guess = psi_new;
+
+    SolveInfo info;
+    info.solver = SolverType::lu;
+    info.residual = -1.0; // G was overwritten by the factorization
+    info.setup_time = duration_cast<duration<double>>(factorized-start).count();
+    info.solve_time = duration_cast<duration<double>>(high_resolution_clock::now()-factorized).count();
+    record_solve(info);
+
+#ifdef VERBOSE
+    cout << "pipelined assembly and LU: " << info.setup_time << " s, solve: " << info.solve_time << " s." << endl;
+#endif
+
+    return psi_new;
+}
+
+// With the dense backend, only G is stored and H*phi is accumulated during the assembly.
+// With the fmm and hmatrix backends, the right hand side H*phi and the products G*v in the
+// iterative solver are evaluated by a compressed representation of the matrices. The solid
+// angle term on the diagonal of H is added in the same way as in assemble_matrices:
+// (H*phi)_i -= (4pi + sum_j H_ij)*phi_i.
+Eigen::VectorXd ColocSim::solve_psi(Mesh const& m,PotVec const& pot) const {
+    if(backend == ColocBackend::dense) {
+        if(solver == SolverType::lu)
+            return solve_pipelined(m,make_copy(pot));
+        Eigen::VectorXd H_phi;
+        assemble_matrix_product(work.G,H_phi,m,make_copy(pot));
+        return solve_system(work.G,H_phi,m);
+    }
+
+#if LINEAR
+#ifdef VERBOSE
+    auto start = high_resolution_clock::now();
+#endif
+
+    omp_set_num_threads(num_threads);
+
+    unique_ptr<ColocMatrices> matrices;
+    if(backend == ColocBackend::fmm) {
+        MultipoleTree* tree = new MultipoleTree(m.verts,m.trigs,inter,fmm_theta);
+        tree->build_colocation(MIRROR_MESH);
+        matrices.reset(tree);
+    } else {
+        HMatrix* hmat = new HMatrix(m.verts,m.trigs,inter,MIRROR_MESH,hmatrix_eps);
+#ifdef VERBOSE
+        cout << "H-matrix compression: " << real(hmat->stored_entries())/(2.0*m.verts.size()*m.verts.size()) << endl;
+#endif
+        matrices.reset(hmat);
+    }
+
+#ifdef VERBOSE
+    auto end = high_resolution_clock::now();
+    cout << "compressed matrices built, used time = " << duration_cast<duration<double>>(end-start).count() << " s. " << endl;
+#endif
+
+    Eigen::VectorXd phi_l(make_copy(pot));
+    Eigen::VectorXd H_phi = matrices->multiply_H(phi_l);
+    Eigen::VectorXd H_one = matrices->multiply_H(Eigen::VectorXd::Ones(phi_l.size()));
+    H_phi -= ((4.0*M_PI + H_one.array())*phi_l.array()).matrix();
+
+    return solve_system(MatrixFreeOperator(*matrices),H_phi);
+#else
+    // the compressed representations are only implemented for flat triangles
+    return LinLinSim::solve_psi(m,pot);
+#endif
+}
+
+} // namespace Bem
@@ -10,11 +10,20 @@
 
 namespace Bem {
 
+// backends for the solution of the colocation system:
+// dense:   G and H are assembled as dense matrices (O(N^2) memory and time)
+// fmm:     G*v and H*v are evaluated by a MultipoleTree, the matrices are never stored
+// hmatrix: G and H are stored as hierarchical matrices (HMatrix) with low-rank far field blocks
+enum class ColocBackend { dense, fmm, hmatrix };
+
 class ColocSim : public LinLinSim {
 public:
 
     ColocSim(Mesh const& initial,real p_inf = 1.0, real epsilon = 1.0, real sigma = 0.0, real gamma = 1.0,real (*pressurefield)(vec3 x,real t) = &default_field)
-        :LinLinSim(initial,p_inf,epsilon,sigma,gamma,pressurefield) {
+        :LinLinSim(initial,p_inf,epsilon,sigma,gamma,pressurefield),
+        backend(ColocBackend::dense),
+        fmm_theta(0.3),
+        hmatrix_eps(1e-5) {
             
 #ifdef VERBOSE
             std::cout << "This simulation has linear elements for phi and psi." << std::endl;
@@ -25,6 +34,37 @@ public:
 
     virtual void assemble_matrices(Eigen::MatrixXd& G,Eigen::MatrixXd& H, Mesh const& m) const override;
 
+    // assembles only G and accumulates H*phi during the integration, including the solid angle term,
+    // such that the dense matrix H is never stored (used by solve_psi with the dense backend)
+    void assemble_matrix_product(Eigen::MatrixXd& G,Eigen::VectorXd& H_phi, Mesh const& m,Eigen::VectorXd const& phi) const;
+
+    // solves the colocation system with a TiledLU of G^T whose panels are factorized as soon as the
+    // corresponding blocks of colocation rows are assembled (used by solve_psi with the dense backend
+    // and the lu solver)
+    Eigen::VectorXd solve_pipelined(Mesh const& m,Eigen::VectorXd const& phi) const;
+
+    virtual Eigen::VectorXd solve_psi(Mesh const& m,PotVec const& pot) const override;
+
+    void set_backend(ColocBackend value) {
+        backend = value;
+    }
+
+    // opening angle of the multipole expansions (only used by the fmm backend)
+    void set_fmm_theta(real value) {
+        fmm_theta = value;
+    }
+
+    // relative accuracy of the low-rank blocks (only used by the hmatrix backend)
+    void set_hmatrix_eps(real value) {
+        hmatrix_eps = value;
+    }
+
+protected:
+
+    ColocBackend backend;
+    real fmm_theta;
+    real hmatrix_eps;
+
 };
 
 } // namespace Bem
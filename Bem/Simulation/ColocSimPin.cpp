@@ -30,16 +30,26 @@ void ColocSimPin::assemble_matrices(Eigen::MatrixXd& G,Eigen::MatrixXd& H, Mesh
     G = Eigen::MatrixXd::Zero(m.verts.size(),m.verts.size());
     H = Eigen::MatrixXd::Zero(m.verts.size(),m.verts.size());
 
+    const size_t block_size(128);
+    const size_t num_blocks((m.verts.size() + block_size - 1)/block_size);
+
+#if LINEAR
+    // quadrature points of all triangles, shared by all threads
+    const TriangleCache cache(inter.make_triangle_cache(m.verts,m.trigs));
+#endif
+
+    const CoordVec& x(m.verts);
+    const CoordVec n(generate_vertex_normals(m));
+    const PointsSoA points(x);
+
     omp_set_num_threads(num_threads);
+    work.reserve_scratch(omp_get_max_threads(),m.verts.size());
 
     #pragma omp parallel
     {
     
-    Mesh local(m);
-    const CoordVec& x(local.verts);
-    const CoordVec n(generate_vertex_normals(local));
-    size_t N(local.verts.size());
-    size_t M(local.trigs.size());
+    size_t N(m.verts.size());
+    size_t M(m.trigs.size());
     Integrator int_local(inter);
 
 #ifdef VERBOSE
@@ -50,36 +60,39 @@ void ColocSimPin::assemble_matrices(Eigen::MatrixXd& G,Eigen::MatrixXd& H, Mesh
     }
 #endif
     
-    #pragma omp for
-    for(size_t j = 0;j<M;++j) {
-        Eigen::MatrixXd G_loc = Eigen::MatrixXd::Zero(N,3);
-        Eigen::MatrixXd H_loc = Eigen::MatrixXd::Zero(N,3);
-        const Triplet trip(local.trigs[j]);
-        
-        for(size_t i(0);i<N;++i) {
+    // Each thread computes the rows of a block of colocation points for all triangles, such that
+    // the threads write to disjoint parts of G and H. The contributions of the triangles are added
+    // to each matrix element in the same order for any number of threads (reproducible results).
+    Eigen::MatrixXd& G_loc(work.G_loc[omp_get_thread_num()]);
+    Eigen::MatrixXd& H_loc(work.H_loc[omp_get_thread_num()]);
+    vector<size_t>& batch_scratch(work.batch_scratch[omp_get_thread_num()]);
+
+    #pragma omp for schedule(dynamic)
+    for(size_t b = 0;b<num_blocks;++b) {
+        size_t begin(b*block_size);
+        size_t end(min(N,begin+block_size));
+
+        for(size_t j(0);j<M;++j) {
+            const Triplet trip(m.trigs[j]);
 #if LINEAR
-    #if MIRROR_MESH
-            int_local.integrate_Lin_coloc_local_mir(x,i,trip,G_loc,H_loc);
-    #else
-            int_local.integrate_Lin_coloc_local(x,i,trip,G_loc,H_loc);
-
-    #endif
+            int_local.integrate_Lin_coloc_batch(x,points,cache,begin,end,j,MIRROR_MESH,G_loc,H_loc,batch_scratch);
 #else
-            int_local.integrate_Lin_coloc_local_cubic(x,n,i,trip,G_loc,H_loc);
+            for(size_t i(begin);i<end;++i) {
+                int_local.integrate_Lin_coloc_local_cubic(x,n,i,trip,G_loc,H_loc);
+            }
 #endif
+            for(size_t k(0);k<3;++k) {
+                G.col(trip[k]).segment(begin,end-begin) += G_loc.col(k).segment(begin,end-begin);
+                H.col(trip[k]).segment(begin,end-begin) += H_loc.col(k).segment(begin,end-begin);
+                G_loc.col(k).segment(begin,end-begin).setZero();
+                H_loc.col(k).segment(begin,end-begin).setZero();
+            }
         }
 
 #ifdef VERBOSE
         if(omp_get_thread_num() == 0)
-            cout << " Assembling matrices... progress (approx.): " << float(j+1)/M*100.0*omp_get_num_threads() << "%                                    \r" << flush;
+            cout << " Assembling matrices... progress (approx.): " << float(b+1)/num_blocks*100.0*omp_get_num_threads() << "%                                    \r" << flush;
 #endif
-        #pragma omp critical 
-        {
-        for(size_t k(0);k<3;++k) {
-            G.col(trip[k]) += G_loc.col(k);
-            H.col(trip[k]) += H_loc.col(k);
-        }
-        }   
     }
     }
 
@@ -150,12 +163,12 @@ CoordVec ColocSimPin::position_t(Mesh const& m,PotVec& pot) const {
     }
 
     // setting up the system of equations and solving it.
-    Eigen::MatrixXd G,H;
-    assemble_matrices(G,H,m);
-    Eigen::VectorXd psi_l = solve_system(G,H*make_copy(pot));
+    assemble_matrices(work.G,work.H,m);
+    Eigen::VectorXd psi_l = solve_system(work.G,work.H*make_copy(pot),m);
 
     vector<vec3> normals = generate_triangle_normals(m);
-    vector<vector<size_t>> triangle_indices = generate_triangle_indices(m);
+    shared_ptr<const MeshTopology> topo(get_topology(m));
+    Adjacency const& triangle_indices(topo->triangle_indices);
 
     vector<vec3> vertex_normals = generate_vertex_normals(m);
     vector<vec3> vertex_gradients;
@@ -218,6 +231,7 @@ void ColocSimPin::rearrange_boundary(Mesh& M,vector<bool> bound) const {
         trig.c = inverse_permutation[trig.c];
         M.trigs[i] = trig;
     }
+    M.connectivity_changed();
 }
 
 size_t ColocSimPin::set_x_boundary(Mesh& M, PotVec& phi_init, PotVec& psi_init) const {
@@ -250,6 +264,7 @@ size_t ColocSimPin::set_x_boundary(Mesh& M, PotVec& phi_init, PotVec& psi_init)
         trig.c = inverse_permutation[trig.c];
         M.trigs[i] = trig;
     }
+    M.connectivity_changed();
     cout << "npin = " << npin << endl;
     return npin;
 }
@@ -282,6 +297,7 @@ size_t ColocSimPin::set_x_boundary(Mesh& M) const {
         trig.c = inverse_permutation[trig.c];
         M.trigs[i] = trig;
     }
+    M.connectivity_changed();
     cout << "npin = " << npin << endl;
     return npin;
 }
@@ -308,10 +324,10 @@ void ColocSimPin::remesh(real L) {
     // copy doesn't work properly right now!! there are still some errors to be solved!
     HalfedgeMesh orig_h(mesh);
     vector<size_t> perm;
-    Halfedge* start = orig_h.bounds[0];
-    Halfedge* curr = start;
+    Halfedge start = orig_h.bounds[0];
+    Halfedge curr = start;
     do {
-        vec3 pos = orig_h.vpos[curr->vert];
+        vec3 pos = orig_h.vpos[orig_h.vert(curr)];
         size_t ind_min(mesh.verts.size()-N_pin);
         real dist_min((mesh.verts[ind_min]-pos).norm2());
         for(size_t j(1);j<N_pin;++j) {
@@ -325,7 +341,7 @@ void ColocSimPin::remesh(real L) {
 
         perm.push_back(ind_min);
         
-        curr = curr->next;
+        curr = orig_h.next(curr);
 
     } while (curr != start);
     //cout << "did i survive so far?a" << endl;
@@ -364,14 +380,14 @@ void ColocSimPin::remesh(real L) {
 
     // determine the vertices that are on the loop:
 
-    Halfedge* bound = manip.bounds[0];
-    Halfedge* u(bound);
+    Halfedge bound = manip.bounds[0];
+    Halfedge u(bound);
     size_t n_b(0);
     vector<bool> bounds(manip.verts.size(),false);
     do {
-        //cout << u->vert << ", " << i++ << endl;
-        bounds[u->vert] = true;
-        u = u->next;
+        //cout << manip.vert(u) << ", " << i++ << endl;
+        bounds[manip.vert(u)] = true;
+        u = manip.next(u);
         n_b++;
     } while(u != bound);
 
@@ -418,7 +434,7 @@ void ColocSimPin::remesh(real L) {
     // projecting the new vertices back on the original surface
 
     CoordVec x0 = new_mesh.verts;
-    project_and_interpolate(new_mesh,normals,new_phi,new_psi, mesh, make_copy(phi), make_copy(psi));
+    project_and_interpolate(new_mesh,normals,new_phi,new_psi, mesh, make_copy(phi), make_copy(psi), num_threads);
 
     CoordVec c = new_mesh.verts + (-1.0)*x0;
     new_mesh.verts = nopenetration(eps,1.0,x0,c);
@@ -429,20 +445,20 @@ void ColocSimPin::remesh(real L) {
     vector<vec3> manip_norms = generate_vertex_normals(manip);
     vector<vec3> better_norms(N_pin);
 
-    Halfedge* ha = bound;
+    Halfedge ha = bound;
 
-    vec3 old2(manip.vpos[ha->vert]);
-    ha = ha->next;
-    vec3 old(manip.vpos[ha->vert]);
-    ha = ha->next;
-    vec3 cur(manip.vpos[ha->vert]);
+    vec3 old2(manip.vpos[manip.vert(ha)]);
+    ha = manip.next(ha);
+    vec3 old(manip.vpos[manip.vert(ha)]);
+    ha = manip.next(ha);
+    vec3 cur(manip.vpos[manip.vert(ha)]);
 
-    Halfedge* hb = ha;
+    Halfedge hb = ha;
     do {
 
         // get permutation:
 
-        vec3 pos = manip.vpos[ha->vert];
+        vec3 pos = manip.vpos[manip.vert(ha)];
         size_t ind_min(0);
         real dist_min((new_mesh_II.verts[new_mesh_II.verts.size()-N_pin]-pos).norm2());
         for(size_t j(1);j<N_pin;++j) {
@@ -457,15 +473,15 @@ void ColocSimPin::remesh(real L) {
 
         // done
 
-        vec3 nor = manip_norms[ha->vert];
+        vec3 nor = manip_norms[manip.vert(ha)];
         vec3 nor_orig = nor;
         nor.x = 0.0;
         nor.normalize();
 
-        ha = ha->next;
+        ha = manip.next(ha);
         old2 = old;
         old = cur;
-        cur = manip.vpos[ha->vert];
+        cur = manip.vpos[manip.vert(ha)];
 
         vec3 nor_a = (cur - old).vec(vec3(1,0,0));
         vec3 nor_b = (old - old2).vec(vec3(1,0,0));
@@ -581,6 +597,7 @@ void ColocSimPin::remesh(real L) {
 
     set_phi(new_phi);
     set_psi(new_psi);
+    psi_guess.resize(0); // no warm start of the solver after remeshing the pinned mesh
 
     //if(mesh.check_validity()) cout << "valid." << endl;
 
@@ -66,11 +66,11 @@ void ConConGalerkinSim::assemble_matrices(Eigen::MatrixXd& G,Eigen::MatrixXd& H,
 
 CoordVec ConConGalerkinSim::position_t(Mesh const& m,PotVec const& pot) const {
     
-    Eigen::MatrixXd G,H;
-    assemble_matrices(G,H,m);
-    Eigen::VectorXd psi_l = solve_system(G,H*make_copy(pot));
+    assemble_matrices(work.G,work.H,m);
+    Eigen::VectorXd psi_l = solve_system(work.G,work.H*make_copy(pot));
 
-    vector<vector<size_t>> triangle_indices = generate_triangle_indices(m);
+    shared_ptr<const MeshTopology> topo(get_topology(m));
+    Adjacency const& triangle_indices(topo->triangle_indices);
     CoordVec normals = generate_triangle_normals(m);
     CoordVec tangent_gradients = generate_tangent_gradients(m,pot);
     CoordVec vertex_gradients;
@@ -105,16 +105,17 @@ CoordVec ConConGalerkinSim::position_t(Mesh const& m,PotVec const& pot) const {
 // compute approximation to per vertex tangent gradient using a local fit of the mesh
 CoordVec ConConGalerkinSim::generate_tangent_gradients(Mesh const& m, PotVec const& pot) const {
     
-    vector<vector<size_t>> neighbours = generate_neighbours(m);
-    vector<vector<size_t>> trig_inds = generate_triangle_indices(m);
+    shared_ptr<const MeshTopology> topo(get_topology(m));
+    Adjacency const& neighbours(topo->neighbours);
+    Adjacency const& trig_inds(topo->triangle_indices);
 
     vector<vector<size_t>> verts; // to include second neighbouring triangles 
                                   // otherwise, just take verts = generate_triangle_indices(m)
                                   // Note, that we need triangle indices here and thus cannot
                                   // simply use the function generate_2_ring()
-    for(vector<size_t> const& elm : neighbours) {
+    for(size_t i(0);i<neighbours.size();++i) {
         set<size_t> inds;
-        for(size_t k : elm) {
+        for(size_t k : neighbours[i]) {
             for(size_t j : trig_inds[k]) {
                 inds.insert(j);
             }
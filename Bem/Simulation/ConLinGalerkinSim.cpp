@@ -22,6 +22,9 @@ void ConLinGalerkinSim::assemble_matrices(Eigen::MatrixXd& G,Eigen::MatrixXd& H,
     H = Eigen::MatrixXd::Zero(m.trigs.size(),m.verts.size());
 
 
+    // see GalerkinSim::assemble_matrices: the triangles of one color write to disjoint columns of H.
+    const vector<vector<size_t>> colors(color_triangles(m));
+
     omp_set_num_threads(num_threads);
 
     #pragma omp parallel
@@ -32,6 +35,8 @@ void ConLinGalerkinSim::assemble_matrices(Eigen::MatrixXd& G,Eigen::MatrixXd& H,
     size_t M(local.trigs.size());
     Integrator int_local(inter);
 
+    Eigen::MatrixXd H_loc(M,3);
+
 #ifdef VERBOSE
     #pragma omp master
     {
@@ -40,26 +45,27 @@ void ConLinGalerkinSim::assemble_matrices(Eigen::MatrixXd& G,Eigen::MatrixXd& H,
     }
 #endif
     
-    #pragma omp for
-    for(size_t j = 0;j<M;++j) {
-        Eigen::MatrixXd H_loc = Eigen::MatrixXd::Zero(M,3);
-        const Triplet trip(local.trigs[j]);
+    for(size_t c(0);c<colors.size();++c) {
+
+        #pragma omp for
+        for(size_t l = 0;l<colors[c].size();++l) {
+            const size_t j(colors[c][l]);
+            const Triplet trip(local.trigs[j]);
+            H_loc.setZero();
         
-        for(size_t i(0);i<M;++i) {
-            int_local.integrate_ConLin_local(x,local.trigs[i],trip,i,j,G,H_loc);
+            for(size_t i(0);i<M;++i) {
+                int_local.integrate_ConLin_local(x,local.trigs[i],trip,i,j,G,H_loc);
+            }
+
+            for(size_t k(0);k<3;++k) {
+                H.col(trip[k]) += H_loc.col(k);
+            }
         }
 
 #ifdef VERBOSE
-        if(omp_get_thread_num() == 0)
-            cout << " Assembling matrices... progress (approx.): " << float(j+1)/M*100.0*omp_get_num_threads() << "%                                    \r" << flush;
+        #pragma omp master
+        cout << " Assembling matrices... progress: " << float(c+1)/colors.size()*100.0 << "%                                    \r" << flush;
 #endif
-        #pragma omp critical 
-        {
-        for(size_t k(0);k<3;++k) {
-            H.col(trip[k]) += H_loc.col(k);
-        }
-        }
-  
     }
     }
 
@@ -75,11 +81,11 @@ void ConLinGalerkinSim::assemble_matrices(Eigen::MatrixXd& G,Eigen::MatrixXd& H,
 CoordVec ConLinGalerkinSim::position_t(Mesh const& m,PotVec const& pot) const {
 
     // setting up the system of equations and solving it.
-    Eigen::MatrixXd G,H;
-    assemble_matrices(G,H,m);
-    Eigen::VectorXd psi_l = solve_system(G,H*make_copy(pot));
+    assemble_matrices(work.G,work.H,m);
+    Eigen::VectorXd psi_l = solve_system(work.G,work.H*make_copy(pot));
 
-    vector<vector<size_t>> triangle_indices = generate_triangle_indices(m);
+    shared_ptr<const MeshTopology> topo(get_topology(m));
+    Adjacency const& triangle_indices(topo->triangle_indices);
     vector<vec3> normals = generate_triangle_normals(m);
     vector<vec3> tangent_gradients = generate_tangent_gradients(m,pot);
     vector<vec3> vertex_gradients;
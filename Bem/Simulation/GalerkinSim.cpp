@@ -24,6 +24,11 @@ void GalerkinSim::assemble_matrices(Eigen::MatrixXd& G,Eigen::MatrixXd& H, Mesh
     G = Eigen::MatrixXd::Zero(m.verts.size(),m.verts.size());
     H = Eigen::MatrixXd::Zero(m.verts.size(),m.verts.size());
 
+    // the triangles are processed color by color: the triangles of one color do not share any
+    // vertex, thus the threads write to disjoint columns of G and H. Each matrix element receives
+    // its contributions in the same order for any number of threads (reproducible results).
+    const vector<vector<size_t>> colors(color_triangles(m));
+
     omp_set_num_threads(num_threads);
 
     #pragma omp parallel
@@ -31,11 +36,13 @@ void GalerkinSim::assemble_matrices(Eigen::MatrixXd& G,Eigen::MatrixXd& H, Mesh
     
     Mesh local(m);
     const vector<vec3>& x(local.verts);
-    const vector<vec3> n(generate_vertex_normals(local));
     size_t N(local.verts.size());
     size_t M(local.trigs.size());
     Integrator int_local(inter);
 
+    Eigen::MatrixXd G_loc(N,3);
+    Eigen::MatrixXd H_loc(N,3);
+
 #ifdef VERBOSE
     #pragma omp master
     {
@@ -44,28 +51,29 @@ void GalerkinSim::assemble_matrices(Eigen::MatrixXd& G,Eigen::MatrixXd& H, Mesh
     }
 #endif
     
-    #pragma omp for
-    for(size_t j = 0;j<M;++j) {
-        Eigen::MatrixXd G_loc = Eigen::MatrixXd::Zero(N,3);
-        Eigen::MatrixXd H_loc = Eigen::MatrixXd::Zero(N,3);
-        const Triplet trip(local.trigs[j]);
+    for(size_t c(0);c<colors.size();++c) {
+
+        #pragma omp for
+        for(size_t l = 0;l<colors[c].size();++l) {
+            const size_t j(colors[c][l]);
+            const Triplet trip(local.trigs[j]);
+            G_loc.setZero();
+            H_loc.setZero();
         
-        for(size_t i(0);i<M;++i) {
-            int_local.integrate_LinLin_local(x,local.trigs[i],trip,G_loc,H_loc);
+            for(size_t i(0);i<M;++i) {
+                int_local.integrate_LinLin_local(x,local.trigs[i],trip,G_loc,H_loc);
+            }
+
+            for(size_t k(0);k<3;++k) {
+                G.col(trip[k]) += G_loc.col(k);
+                H.col(trip[k]) += H_loc.col(k);
+            }
         }
 
 #ifdef VERBOSE
-        if(omp_get_thread_num() == 0)
-            cout << " Assembling matrices... progress (approx.): " << float(j+1)/M*100.0*omp_get_num_threads() << "%                                    \r" << flush;
+        #pragma omp master
+        cout << " Assembling matrices... progress: " << float(c+1)/colors.size()*100.0 << "%                                    \r" << flush;
 #endif
-        #pragma omp critical 
-        {
-        for(size_t k(0);k<3;++k) {
-            G.col(trip[k]) += G_loc.col(k);
-            H.col(trip[k]) += H_loc.col(k);
-        }
-        }
-   
     }
     }
 
@@ -1,6 +1,7 @@
 #include "LinLinSim.hpp"
 #include "../Integration/Integrator.hpp"
 #include "../Integration/ResultTypes.hpp"
+#include "../Integration/MultipoleTree.hpp"
 #include "../basic/Bem.hpp"
 #include "../Mesh/FittingTool.hpp"
 #include "../Mesh/Mesh.hpp"
@@ -23,16 +24,20 @@ using namespace chrono;
 
 namespace Bem {
 
+Eigen::VectorXd LinLinSim::solve_psi(Mesh const& m,PotVec const& pot) const {
+    assemble_matrices(work.G,work.H,m);
+    return solve_system(work.G,work.H*make_copy(pot),m);
+}
+
 CoordVec LinLinSim::position_t(Mesh const& m,PotVec& pot) const {
     CoordVec result;
 
     // setting up the system of equations and solving it.
-    Eigen::MatrixXd G,H;
-    assemble_matrices(G,H,m);
-    Eigen::VectorXd psi_l = solve_system(G,H*make_copy(pot));
+    Eigen::VectorXd psi_l = solve_psi(m,pot);
 
     vector<vec3> normals = generate_triangle_normals(m);
-    vector<vector<size_t>> triangle_indices = generate_triangle_indices(m);
+    shared_ptr<const MeshTopology> topo(get_topology(m));
+    Adjacency const& triangle_indices(topo->triangle_indices);
     vector<vec3> tangent_gradients = generate_tangent_gradients(m,pot);
 
     vector<vec3> vertex_normals = generate_vertex_normals(m);
@@ -197,11 +202,8 @@ void LinLinSim::evolve_system_RK4(real dp, bool fixdt) {
     cout << "begin_RK4" << endl;
     test_negative();
 
-    Mesh m2 = mesh;
-    Mesh m3 = mesh;
-    Mesh m4 = mesh;
-    
-    CoordVec x1 = mesh.verts;
+    frozen_lu.valid = false; // the first stage computes the frozen_lu preconditioner for the four stages
+
     PotVec p1 = get_phi();
 
     CoordVec k1_x = position_t(mesh,p1);
@@ -215,6 +217,28 @@ void LinLinSim::evolve_system_RK4(real dp, bool fixdt) {
 #ifdef VERBOSE
     cout << "\n dt = " << dt << endl << endl;
 #endif
+    rk4_stages(dt,k1_x,k1_p);
+
+    cout << "end_RK4" << endl;
+    test_negative();
+}
+
+// the remaining stages of the classical Runge-Kutta method for the step dt, given the first stage
+void LinLinSim::rk4_stages(real dt,CoordVec const& k1_x,PotVec const& k1_p) {
+
+    // the stage meshes are kept in the workspace, such that copying the connectivity doesn't allocate, and
+    // they share the topology of the mesh
+    work.stages.resize(3);
+    Mesh& m2(work.stages[0]);
+    Mesh& m3(work.stages[1]);
+    Mesh& m4(work.stages[2]);
+    get_topology(mesh);
+    for(Mesh& stage : work.stages)
+        stage.copy_connectivity(mesh);
+
+    CoordVec x1 = mesh.verts;
+    PotVec p1 = get_phi();
+
     CoordVec x2 = x1 + (0.5*dt)*k1_x;
     m2.verts = x2;
     PotVec p2 = p1 + (0.5*dt)*k1_p;
@@ -235,30 +259,232 @@ void LinLinSim::evolve_system_RK4(real dp, bool fixdt) {
     
     CoordVec average = (k1_x + 2.0*k2_x + 2.0*k3_x + k4_x)*(1.0/6.0);
 
-    PotVec pf = p1 + (dt/6.0)*(pot_t_multi(mesh,k1_x,time) + 2.0*pot_t_multi(m2,k2_x,time) + 2.0*pot_t_multi(m3,k3_x,time) + pot_t_multi(m4,k4_x,time));
+    PotVec pf = p1 + (dt/6.0)*(k1_p + 2.0*k2_p + 2.0*k3_p + pot_t_multi(m4,k4_x,time));
     
     mesh.verts = nopenetration(eps,dt,x1,average);
 
     // set a value for psi (after we updated mesh)
     if(size_t(psi.size()) != average.size()) cout << "psi: " << psi.size() << " - new-psi: " << average.size() << "          XXXXX" << endl; 
-    PotVec new_psi(average.size());
+    update_psi(average);
+
+    // update phi
+    set_phi(pf);
+    time += dt;
+}
+
+// psi is set to the normal component of the velocities of the vertices (of the updated mesh)
+void LinLinSim::update_psi(CoordVec const& velocities) {
+    PotVec new_psi(velocities.size());
     vector<vec3> normals = generate_vertex_normals(mesh);
-    for(size_t i(0);i<average.size();++i) {
-        new_psi[i] = average[i].dot(normals[i]);
+    for(size_t i(0);i<velocities.size();++i) {
+        new_psi[i] = velocities[i].dot(normals[i]);
     }
     set_psi(new_psi);
+}
 
-    // update phi
-    set_phi(pf);
+// true if the vertices and phi of the simulation are still verts and pot (the stored derivatives
+// of the time integrators belong to this state)
+bool LinLinSim::same_state(CoordVec const& verts,PotVec const& pot) const {
+    if(verts.size() != mesh.verts.size() or pot != make_copy(phi))
+        return false;
+    for(size_t i(0);i<verts.size();++i) {
+        if((verts[i]-mesh.verts[i]).norm2() != 0.0)
+            return false;
+    }
+    return true;
+}
+
+// The Bogacki-Shampine pair: the stages k1,...,k3 give the third order solution
+//     y_n+1 = y_n + dt*(2/9 k1 + 1/3 k2 + 4/9 k3),
+// k4 = f(y_n+1) gives the second order solution z_n+1 = y_n + dt*(7/24 k1 + 1/4 k2 + 1/3 k3 + 1/8 k4),
+// and y_n+1 - z_n+1 is the estimate of the local error. k4 is the k1 of the next step, so an accepted
+// step needs three BEM solves (four if the first stage can't be reused).
+void LinLinSim::evolve_system_BS3(real dp, bool fixdt) {
+
+    test_negative();
+
+    frozen_lu.valid = false;
+
+    CoordVec x1 = mesh.verts;
+    PotVec p1 = get_phi();
+
+    CoordVec k1_x;
+    PotVec k1_p;
+    if(same_state(rk_state.verts,rk_state.phi)) {
+        k1_x = rk_state.k_x;
+        k1_p = rk_state.k_p;
+    } else {
+        k1_x = position_t(mesh,p1);
+        k1_p = pot_t_multi(mesh,k1_x,time);
+    }
+
+    real dt;
+    if(fixdt)                   dt = dp;
+    else if(rk_state.dt > 0.0)  dt = rk_state.dt;
+    else                        dt = get_dt(dp,k1_x,k1_p);
+    if(not fixdt and min_dt > 0.0) dt = min(dt,min_dt);
+
+    work.stages.resize(3);
+    Mesh& m2(work.stages[0]);
+    Mesh& m3(work.stages[1]);
+    Mesh& m4(work.stages[2]);
+    get_topology(mesh);
+    for(Mesh& stage : work.stages)
+        stage.copy_connectivity(mesh);
+
+    CoordVec k4_x, average;
+    PotVec k4_p, p4;
+    real error;
+    size_t rejections(0);
+    while(true) {
+        m2.verts = x1 + (0.5*dt)*k1_x;
+        PotVec p2 = p1 + (0.5*dt)*k1_p;
+        CoordVec k2_x = position_t(m2,p2);
+        PotVec k2_p = pot_t_multi(m2,k2_x,time + 0.5*dt);
+
+        m3.verts = x1 + (0.75*dt)*k2_x;
+        PotVec p3 = p1 + (0.75*dt)*k2_p;
+        CoordVec k3_x = position_t(m3,p3);
+        PotVec k3_p = pot_t_multi(m3,k3_x,time + 0.75*dt);
+
+        average = (2.0/9.0)*k1_x + (1.0/3.0)*k2_x + (4.0/9.0)*k3_x;
+        p4 = p1 + dt*((2.0/9.0)*k1_p + (1.0/3.0)*k2_p + (4.0/9.0)*k3_p);
+        m4.verts = nopenetration(eps,dt,x1,average);
+
+        k4_x = position_t(m4,p4);
+        k4_p = pot_t_multi(m4,k4_x,time + dt);
+
+        // maximum of the local errors relative to the tolerance
+        error = 0.0;
+        for(size_t i(0);i<x1.size();++i) {
+            vec3 e_x = dt*((-5.0/72.0)*k1_x[i] + (1.0/12.0)*k2_x[i] + (1.0/9.0)*k3_x[i] - (1.0/8.0)*k4_x[i]);
+            real e_p = dt*((-5.0/72.0)*k1_p[i] + (1.0/12.0)*k2_p[i] + (1.0/9.0)*k3_p[i] - (1.0/8.0)*k4_p[i]);
+            error = max(error,e_x.norm()/(rk_tolerance*(1.0 + x1[i].norm())));
+            error = max(error,abs(e_p)/(rk_tolerance*(1.0 + abs(p1[i]))));
+        }
+
+        if(fixdt or error <= 1.0 or rejections == 10)
+            break;
+
+        // the error of a third order step scales with dt^3
+        dt *= max(0.2,0.9/cbrt(error));
+        rejections++;
+        rejected_steps++;
+#ifdef VERBOSE
+        cout << "step rejected (error " << error << "), new dt = " << dt << endl;
+#endif
+    }
+    if(rejections == 10) cout << "error control: accepted step with error " << error << endl;
+
+#ifdef VERBOSE
+    cout << "\n dt = " << dt << endl << endl;
+#endif
+
+    mesh.verts = m4.verts;
+    update_psi(average);
+
+    set_phi(p4);
     time += dt;
 
-    cout << "end_RK4" << endl;
+    rk_state.verts = mesh.verts;
+    rk_state.phi = p4;
+    rk_state.k_x = k4_x;
+    rk_state.k_p = k4_p;
+    rk_state.dt = (error > 0.0) ? dt*min(5.0,max(0.2,0.9/cbrt(error))) : 5.0*dt;
+
+    test_negative();
+}
+
+// Fourth order Adams-Bashforth-Moulton method in PEC mode (predict, evaluate, correct):
+//     y*_n+1 = y_n + dt/24*(55 f_n - 59 f_n-1 + 37 f_n-2 - 9 f_n-3)
+//     f_n+1  = f(y*_n+1)
+//     y_n+1  = y_n + dt/24*(9 f_n+1 + 19 f_n - 5 f_n-1 + f_n-2)
+// The derivative at the corrected state isn't evaluated again, f_n+1 is stored in the history for the
+// next step, so each step needs a single BEM solve. The history requires a constant step size. It is
+// restarted if the state was changed in between (remesh, set_phi), if dp changes (fixdt) resp. if the
+// step size limit given by get_dt is smaller than the step size of the history (a step is never larger
+// than the limit) or more than twice as large. The first three steps after a restart are RK4 steps, whose
+// first stages are kept in the history.
+void LinLinSim::evolve_system_ABM(real dp, bool fixdt) {
+
+    test_negative();
+
+    frozen_lu.valid = false;
+
+    MultistepState& h(ms_state);
+    if(not same_state(h.verts,h.phi)) {
+        h.k_x.clear();
+        h.k_p.clear();
+    }
+
+    PotVec p1 = get_phi();
+
+    // derivative at the current state
+    if(h.k_x.empty()) {
+        h.k_x.push_back(position_t(mesh,p1));
+        h.k_p.push_back(pot_t_multi(mesh,h.k_x.back(),time));
+    }
+
+    real dt;
+    if(fixdt) dt = dp;
+    else      dt = get_dt(dp,h.k_x.back(),h.k_p.back());
+    if(h.k_x.size() > 1 and (fixdt ? dt != h.dt : (dt < h.dt or dt > 2.0*h.dt))) {
+        h.k_x.erase(h.k_x.begin(),h.k_x.end()-1);
+        h.k_p.erase(h.k_p.begin(),h.k_p.end()-1);
+    }
+    if(h.k_x.size() > 1) dt = h.dt;
+    h.dt = dt;
+
+#ifdef VERBOSE
+    cout << "\n dt = " << dt << endl << endl;
+#endif
+
+    if(h.k_x.size() < 4) {
+        // bootstrapping: RK4 step, its first stage is f_n
+        rk4_stages(dt,h.k_x.back(),h.k_p.back());
+        PotVec p = get_phi();
+        h.k_x.push_back(position_t(mesh,p));
+        h.k_p.push_back(pot_t_multi(mesh,h.k_x.back(),time));
+    } else {
+        CoordVec x1 = mesh.verts;
+        size_t n(3);
+        CoordVec const* k_x = &h.k_x[0];
+        PotVec const* k_p = &h.k_p[0];
+
+        work.stages.resize(1);
+        Mesh& m_pred(work.stages[0]);
+        get_topology(mesh);
+        m_pred.copy_connectivity(mesh);
+        m_pred.verts = x1 + (dt/24.0)*(55.0*k_x[n] + (-59.0)*k_x[n-1] + 37.0*k_x[n-2] + (-9.0)*k_x[n-3]);
+        PotVec p_pred = p1 + (dt/24.0)*(55.0*k_p[n] + (-59.0)*k_p[n-1] + 37.0*k_p[n-2] + (-9.0)*k_p[n-3]);
+
+        CoordVec f_x = position_t(m_pred,p_pred);
+        PotVec f_p = pot_t_multi(m_pred,f_x,time + dt);
+
+        CoordVec average = (1.0/24.0)*(9.0*f_x + 19.0*k_x[n] + (-5.0)*k_x[n-1] + k_x[n-2]);
+        PotVec pf = p1 + (dt/24.0)*(9.0*f_p + 19.0*k_p[n] + (-5.0)*k_p[n-1] + k_p[n-2]);
+
+        mesh.verts = nopenetration(eps,dt,x1,average);
+        update_psi(average);
+        set_phi(pf);
+        time += dt;
+
+        h.k_x.erase(h.k_x.begin());
+        h.k_p.erase(h.k_p.begin());
+        h.k_x.push_back(f_x);
+        h.k_p.push_back(f_p);
+    }
+
+    h.verts = mesh.verts;
+    h.phi = get_phi();
+
     test_negative();
 }
 
 // evolving the system in time with the Euler method. Alternatively evolve_system_RK4 can be used.
 void LinLinSim::evolve_system(real dp, bool fixdt) {
 
+    frozen_lu.valid = false;
     PotVec p = make_copy(phi);
 
     CoordVec grads = position_t(mesh,p);
@@ -333,7 +559,7 @@ vector<real> LinLinSim::curvature_param() const {
     }
 
     /*
-    vector<vector<size_t>> trig_inds = generate_triangle_indices(mesh);
+    Adjacency trig_inds = generate_triangle_indices(mesh);
     vector<real> meandiffgrad(mesh.verts.size());
     for(size_t i(0);i<trig_inds.size();++i){
         real mean = 0.0;
@@ -366,7 +592,8 @@ vector<real> LinLinSim::curvature_param() const {
 
     // smoothing the parameters by averaging 
     // over the 2 ring neighbours
-    vector<vector<size_t>> two_ring(generate_2_ring(mesh));
+    shared_ptr<const MeshTopology> topo(get_topology(mesh));
+    Adjacency const& two_ring(topo->two_ring);
     vector<real> max_curv_tmp = max_curv;
     for(size_t i(0);i<mesh.verts.size();++i){
         real mean_curvature = 0.0;
@@ -428,21 +655,44 @@ void LinLinSim::remesh(real L) {
     relax_vertices(manip);
     flip_edges(manip,1);
     relax_vertices(manip);
-    vector<real> new_phi;
-    
     Mesh new_mesh = generate_mesh(manip);
-    // projecting the new vertices back on the original surface
-    project_and_interpolate(new_mesh,new_phi, mesh, make_copy(phi));
+    // projecting the new vertices back on the original surface, interpolating phi and
+    // the last solution psi_guess (initial guess for the next solve). The search for the
+    // intersections starts at a triangle of the vertex each new vertex originates from.
+    vector<vector<real>> fields = {make_copy(phi)};
+    bool transfer_guess(size_t(psi_guess.size()) == mesh.verts.size());
+    if(transfer_guess) fields.push_back(make_copy(psi_guess));
+    shared_ptr<const MeshTopology> topo(get_topology(mesh));
+    vector<size_t> seed_trigs(new_mesh.verts.size(),-1); // an invalid seed makes the walk fail
+    for(size_t i(0);i<seed_trigs.size();++i) {
+        Adjacency::Row trigs(topo->triangle_indices[manip.origin[i]]);
+        if(not trigs.empty()) seed_trigs[i] = trigs[0];
+    }
+    vector<vector<real>> new_fields;
+    project_and_interpolate(new_mesh,generate_vertex_normals(new_mesh),new_fields, mesh, fields, seed_trigs, num_threads);
     mesh = new_mesh;
-    set_phi(new_phi);
+    set_phi(new_fields[0]);
+    if(transfer_guess) psi_guess = make_copy(new_fields[1]);
+    else               psi_guess.resize(0);
 }
 
-PotVec compute_exterior_pot(CoordVec const& pos,Mesh M,PotVec phi,PotVec psi) {
+PotVec compute_exterior_pot(CoordVec const& pos,Mesh const& M,PotVec const& phi,PotVec const& psi,real theta) {
+
+    if(theta > 0.0) {
+        Integrator inter;
+        inter.set_quadrature(quadrature_19);
+        MultipoleTree tree(M.verts,M.trigs,inter,theta);
+        return tree.exterior_potential(pos,make_copy(phi),make_copy(psi));
+    }
 
     size_t N = pos.size();
 
     PotVec phi_ext(N);
 
+    Integrator inter;
+    inter.set_quadrature(quadrature_19);
+    const TriangleCache cache(inter.make_triangle_cache(M.verts,M.trigs));
+
     #pragma omp parallel
     {
     
@@ -451,16 +701,17 @@ PotVec compute_exterior_pot(CoordVec const& pos,Mesh M,PotVec phi,PotVec psi) {
     cout << "thread " << omp_get_thread_num() << " working..." << endl;
     }
 
-    Integrator inter;
-    inter.set_quadrature(quadrature_19);
-
     #pragma omp for
     for(size_t i = 0;i < N; ++i) {
         Bem::real val(0.0);
-        for(Triplet t : M.trigs) {
-            val += inter.get_exterior_potential(M.verts,t,phi,psi,pos[i]);
+        for(size_t j(0);j<M.trigs.size();++j) {
+            // same as Integrator::get_exterior_potential, with the cached quadrature points
+            HomoPair<LinElm> e;
+            inter.integrate_Lin_point_elements(cache,pos[i],j,e);
+            for(size_t k(0);k<3;++k)
+                val += e.H[k]*phi[M.trigs[j][k]] - e.G[k]*psi[M.trigs[j][k]];
         }
-        phi_ext[i] = val;
+        phi_ext[i] = val/(4.0*M_PI);
 
         if(omp_get_thread_num() == 0)
             cout << " Computing external potential... progress (approx.): " << float(i+1)/N*100.0*omp_get_num_threads() << "%                                    \r" << flush;
@@ -476,12 +727,10 @@ PotVec compute_exterior_pot(CoordVec const& pos,Mesh M,PotVec phi,PotVec psi) {
     return phi_ext;
 }
 
-PotVec LinLinSim::exterior_pot(CoordVec const& positions) const {
-    Eigen::MatrixXd G,H;
-    assemble_matrices(G,H,mesh);
-    Eigen::VectorXd psi_l = solve_system(G,H*phi);
+PotVec LinLinSim::exterior_pot(CoordVec const& positions,real theta) const {
+    Eigen::VectorXd psi_l = solve_psi(mesh,make_copy(phi));
 
-    return compute_exterior_pot(positions,mesh,make_copy(phi),make_copy(psi_l));
+    return compute_exterior_pot(positions,mesh,make_copy(phi),make_copy(psi_l),theta);
 }
 
 
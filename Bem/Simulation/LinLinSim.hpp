@@ -14,7 +14,10 @@
 
 namespace Bem {
 
-PotVec compute_exterior_pot(CoordVec const& pos,Mesh M,PotVec phi,PotVec psi);
+// computes the potential at the points pos, given phi and psi on the mesh M. If theta > 0, a
+// MultipoleTree with opening angle theta is used (faster, approximate), else the integrals over
+// all triangles are summed up directly.
+PotVec compute_exterior_pot(CoordVec const& pos,Mesh const& M,PotVec const& phi,PotVec const& psi,real theta = 0.0);
 
 class LinLinSim : public Simulation {
 public:
@@ -24,7 +27,9 @@ public:
         eps(1e-2),
         damping_factor(0.0),
         min_elm_size(0.0),
-        max_elm_size(std::numeric_limits<real>::max()) {
+        max_elm_size(std::numeric_limits<real>::max()),
+        rk_tolerance(1e-4),
+        rejected_steps(0) {
             phi = Eigen::VectorXd::Zero(phi_dim());
             psi = Eigen::VectorXd::Zero(psi_dim());
 
@@ -46,6 +51,14 @@ public:
     
     virtual void evolve_system(real dp, bool fixdt = false) override;
     virtual void evolve_system_RK4(real dp, bool fixdt = false);
+    // embedded Runge-Kutta method of Bogacki and Shampine (order 3, error estimate of order 2), see
+    // set_rk_tolerance. dp determines the first step (as in evolve_system_RK4), the following step sizes
+    // are chosen by the error control. If fixdt is set, every step has the size dp.
+    virtual void evolve_system_BS3(real dp, bool fixdt = false);
+    // fourth order Adams-Bashforth-Moulton multistep method with one BEM solve per step (after three
+    // RK4 steps, which are repeated whenever the history of derivatives has to be restarted, e.g. after
+    // remesh). Without fixdt, the step size of the first step (get_dt) is kept as long as possible.
+    virtual void evolve_system_ABM(real dp, bool fixdt = false);
 
     virtual void remesh(real L);
 
@@ -61,15 +74,30 @@ public:
         max_elm_size = value;
     }
 
+    // local error per step of evolve_system_BS3, relative to 1 + |x_i| for the positions resp. 1 + |phi_i|
+    // for the potential
+    void set_rk_tolerance(real value) {
+        rk_tolerance = value;
+    }
+
+    // number of steps of evolve_system_BS3 which were rejected by the error control and repeated
+    size_t get_rejected_steps() const {
+        return rejected_steps;
+    }
+
 
     std::vector<real> kappa(Mesh const& m) const;
 
+    // solves the boundary integral equation on the mesh m for the given potential and
+    // returns its normal derivative psi. By default the dense system is assembled and solved.
+    virtual Eigen::VectorXd solve_psi(Mesh const& m,PotVec const& pot) const;
+
     virtual CoordVec position_t(Mesh const& m,PotVec& pot) const;
     PotVec   pot_t(Mesh const& m,CoordVec const& gradients, real t) const;
     PotVec   pot_t_multi(Mesh const& m,CoordVec const& gradients, real t) const;
 
 
-    PotVec exterior_pot(CoordVec const& positions) const;
+    PotVec exterior_pot(CoordVec const& positions,real theta = 0.0) const;
 
     CoordVec nopenetration(real eps, real dt,CoordVec const& x0,CoordVec& c) const;
 
@@ -79,6 +107,10 @@ protected:
 
     void test_negative() const;
 
+    void rk4_stages(real dt,CoordVec const& k1_x,PotVec const& k1_p);
+    void update_psi(CoordVec const& velocities);
+    bool same_state(CoordVec const& verts,PotVec const& pot) const;
+
     std::vector<vec3> generate_tangent_gradients(Mesh const& m, std::vector<real> const& pot) const;
 
     std::vector<real> curvature_param() const;
@@ -86,6 +118,31 @@ protected:
     real damping_factor;
     real min_elm_size, max_elm_size;
     PotVec curvature_params;
+
+    // The last stage of an accepted step of evolve_system_BS3 is evaluated at the new state and serves as
+    // the first stage of the following step (first same as last), if the state wasn't changed in between
+    // (e.g. by remesh or set_phi). dt is the step size proposed by the error control.
+    struct AdaptiveRKState {
+        CoordVec verts;
+        PotVec phi;
+        CoordVec k_x;
+        PotVec k_p;
+        real dt = -1.0;
+    };
+    AdaptiveRKState rk_state;
+
+    // history of evolve_system_ABM: the derivatives f_n-3,...,f_n (at most four, f_n being the last) of
+    // the steps with size dt leading to the state verts, phi
+    struct MultistepState {
+        CoordVec verts;
+        PotVec phi;
+        std::vector<CoordVec> k_x;
+        std::vector<PotVec> k_p;
+        real dt = -1.0;
+    };
+    MultistepState ms_state;
+    real rk_tolerance;
+    size_t rejected_steps;
     
 };
 
@@ -0,0 +1,110 @@
+#ifndef MATRIXFREEOPERATOR_HPP
+#define MATRIXFREEOPERATOR_HPP
+
+#include "../Integration/ColocMatrices.hpp"
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <Eigen/IterativeLinearSolvers>
+
+// The MatrixFreeOperator wraps the single layer product of a compressed representation
+// of G (MultipoleTree or HMatrix), such that it can be used like a matrix by the iterative
+// solvers of Eigen (matrix-free). The dense matrix G is never formed.
+
+namespace Bem {
+class MatrixFreeOperator;
+}
+
+namespace Eigen {
+namespace internal {
+    template<>
+    struct traits<Bem::MatrixFreeOperator> : public Eigen::internal::traits<Eigen::SparseMatrix<double>> {};
+}
+}
+
+namespace Bem {
+
+class MatrixFreeOperator : public Eigen::EigenBase<MatrixFreeOperator> {
+public:
+    typedef double Scalar;
+    typedef double RealScalar;
+    typedef int StorageIndex;
+    enum {
+        ColsAtCompileTime = Eigen::Dynamic,
+        MaxColsAtCompileTime = Eigen::Dynamic,
+        IsRowMajor = false
+    };
+
+    MatrixFreeOperator(ColocMatrices const& matrices) :matrices(matrices) {}
+
+    Eigen::Index rows() const { return matrices.size(); }
+    Eigen::Index cols() const { return matrices.size(); }
+
+    template<typename Rhs>
+    Eigen::Product<MatrixFreeOperator,Rhs,Eigen::AliasFreeProduct> operator*(Eigen::MatrixBase<Rhs> const& x) const {
+        return Eigen::Product<MatrixFreeOperator,Rhs,Eigen::AliasFreeProduct>(*this,x.derived());
+    }
+
+    ColocMatrices const& get_matrices() const {
+        return matrices;
+    }
+
+private:
+    ColocMatrices const& matrices;
+};
+
+// Jacobi preconditioner for the MatrixFreeOperator, using the diagonal of G.
+class MatrixFreeJacobi {
+public:
+    typedef Eigen::VectorXd Vector;
+    typedef int StorageIndex;
+    enum {
+        ColsAtCompileTime = Eigen::Dynamic,
+        MaxColsAtCompileTime = Eigen::Dynamic
+    };
+
+    MatrixFreeJacobi() {}
+
+    MatrixFreeJacobi& analyzePattern(MatrixFreeOperator const&) { return *this; }
+
+    MatrixFreeJacobi& factorize(MatrixFreeOperator const& op) {
+        inv_diag = op.get_matrices().diagonal_G().cwiseInverse();
+        return *this;
+    }
+
+    MatrixFreeJacobi& compute(MatrixFreeOperator const& op) {
+        return factorize(op);
+    }
+
+    template<typename Rhs>
+    Vector solve(Rhs const& b) const {
+        return inv_diag.cwiseProduct(b);
+    }
+
+    Eigen::ComputationInfo info() { return Eigen::Success; }
+
+private:
+    Vector inv_diag;
+};
+
+} // namespace Bem
+
+namespace Eigen {
+namespace internal {
+
+    template<typename Rhs>
+    struct generic_product_impl<Bem::MatrixFreeOperator,Rhs,SparseShape,DenseShape,GemvProduct>
+        : generic_product_impl_base<Bem::MatrixFreeOperator,Rhs,generic_product_impl<Bem::MatrixFreeOperator,Rhs>> {
+
+        typedef typename Product<Bem::MatrixFreeOperator,Rhs>::Scalar Scalar;
+
+        template<typename Dest>
+        static void scaleAndAddTo(Dest& dst,Bem::MatrixFreeOperator const& lhs,Rhs const& rhs,Scalar const& alpha) {
+            dst.noalias() += alpha*lhs.get_matrices().multiply_G(rhs);
+        }
+    };
+
+}
+}
+
+#endif // MATRIXFREEOPERATOR_HPP
@@ -0,0 +1,91 @@
+#include "Preconditioner.hpp"
+#include <vector>
+
+using namespace std;
+
+namespace Bem {
+
+void SystemPreconditioner::factorize_dense(Eigen::Ref<const Eigen::MatrixXd> G) {
+    size_t N(G.rows());
+
+    active = type;
+    if((type == PreconditionerType::near_field_ilu or type == PreconditionerType::block_jacobi)
+        and (mesh == nullptr or mesh->verts.size() != N))
+        active = PreconditionerType::diagonal;
+    if(type == PreconditionerType::frozen_lu and frozen == nullptr)
+        active = PreconditionerType::diagonal;
+
+    switch(active) {
+        case PreconditionerType::diagonal:
+        {
+            inv_diag = G.diagonal().cwiseInverse();
+            break;
+        }
+        case PreconditionerType::near_field_ilu:
+        {
+            // the near field: the entries of G coupling each vertex with its 2-ring (including itself)
+            shared_ptr<const MeshTopology> topo(get_topology(*mesh));
+            Adjacency const& ring(topo->two_ring);
+            vector<Eigen::Triplet<double>> entries;
+            for(size_t i(0);i<N;++i) {
+                for(size_t j : ring[i])
+                    entries.push_back(Eigen::Triplet<double>(i,j,G(i,j)));
+            }
+            Eigen::SparseMatrix<double> near(N,N);
+            near.setFromTriplets(entries.begin(),entries.end());
+            ilu.compute(near);
+            break;
+        }
+        case PreconditionerType::block_jacobi:
+        {
+            // cached with the topology of the mesh, only the blocks of G are set up again
+            loose_parts = get_loose_parts(*mesh);
+            blocks.clear();
+            for(vector<size_t> const& part : loose_parts->part_verts) {
+                Eigen::MatrixXd block(part.size(),part.size());
+                for(size_t k(0);k<part.size();++k)
+                    for(size_t l(0);l<part.size();++l)
+                        block(k,l) = G(part[k],part[l]);
+                blocks.push_back(Eigen::PartialPivLU<Eigen::MatrixXd>(block));
+            }
+            break;
+        }
+        case PreconditionerType::frozen_lu:
+        {
+            if(not frozen->valid or size_t(frozen->lu.rows()) != N or frozen->uses >= frozen->max_uses) {
+                frozen->lu.compute(G);
+                frozen->valid = true;
+                frozen->uses = 0;
+            }
+            frozen->uses++;
+            break;
+        }
+    }
+}
+
+SystemPreconditioner::Vector SystemPreconditioner::apply(Vector const& b) const {
+    switch(active) {
+        case PreconditionerType::near_field_ilu:
+            return ilu.solve(b);
+        case PreconditionerType::block_jacobi:
+        {
+            vector<vector<size_t>> const& parts(loose_parts->part_verts);
+            Vector x(b.size());
+            for(size_t p(0);p<parts.size();++p) {
+                Vector b_p(parts[p].size());
+                for(size_t k(0);k<parts[p].size();++k)
+                    b_p(k) = b(parts[p][k]);
+                Vector x_p = blocks[p].solve(b_p);
+                for(size_t k(0);k<parts[p].size();++k)
+                    x(parts[p][k]) = x_p(k);
+            }
+            return x;
+        }
+        case PreconditionerType::frozen_lu:
+            return frozen->lu.solve(b);
+        default:
+            return inv_diag.cwiseProduct(b);
+    }
+}
+
+} // namespace Bem
@@ -0,0 +1,105 @@
+#ifndef PRECONDITIONER_HPP
+#define PRECONDITIONER_HPP
+
+#include <vector>
+#include <memory>
+#include "../basic/Bem.hpp"
+#include "../Mesh/Mesh.hpp"
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <Eigen/IterativeLinearSolvers>
+
+namespace Bem {
+
+// preconditioners for the iterative solution of the dense system G*psi = H*phi:
+// diagonal:       Jacobi preconditioner (the default of Eigen's BiCGSTAB)
+// near_field_ilu: incomplete LU (IncompleteLUT) of the sparse part of G which couples each vertex with
+//                 its 2-ring (generate_2_ring)
+// block_jacobi:   LU decompositions of the diagonal blocks of G belonging to the loose parts of the mesh
+//                 (get_loose_parts), i.e. the interaction between different bubbles is neglected
+// frozen_lu:      LU decomposition of G, computed once and reused as preconditioner for the following
+//                 solves (e.g. the stages of an RK4 step), see FrozenLU
+enum class PreconditionerType { diagonal, near_field_ilu, block_jacobi, frozen_lu };
+
+// The FrozenLU is kept by the Simulation between the solves. The decomposition is recomputed if it is
+// invalidated (at the beginning of each time step), if the size of the system changed (remeshing) or
+// after it was used max_uses times.
+struct FrozenLU {
+    Eigen::PartialPivLU<Eigen::MatrixXd> lu;
+    bool valid = false;
+    size_t uses = 0;
+    size_t max_uses = 4;
+};
+
+// The SystemPreconditioner implements the preconditioner interface of Eigen's iterative solvers
+// (BiCGSTAB, GMRES) and applies one of the above preconditioners, chosen at runtime with setup().
+class SystemPreconditioner {
+public:
+    typedef Eigen::VectorXd Vector;
+    typedef int StorageIndex;
+    enum {
+        ColsAtCompileTime = Eigen::Dynamic,
+        MaxColsAtCompileTime = Eigen::Dynamic
+    };
+
+    SystemPreconditioner()
+        :type(PreconditionerType::diagonal),
+        mesh(nullptr),
+        frozen(nullptr),
+        active(PreconditionerType::diagonal) {}
+
+    // must be called before compute. near_field_ilu and block_jacobi need the mesh whose vertices correspond
+    // to the unknowns (the diagonal preconditioner is used if it is null or doesn't match the size of the
+    // system), frozen_lu needs frozen.
+    void setup(PreconditionerType type,Mesh const* mesh,FrozenLU* frozen) {
+        this->type = type;
+        this->mesh = mesh;
+        this->frozen = frozen;
+    }
+
+    template<typename MatrixType>
+    SystemPreconditioner& analyzePattern(MatrixType const&) { return *this; }
+
+    template<typename MatrixType>
+    SystemPreconditioner& factorize(MatrixType const& G) {
+        factorize_dense(G);
+        return *this;
+    }
+
+    template<typename MatrixType>
+    SystemPreconditioner& compute(MatrixType const& G) {
+        return factorize(G);
+    }
+
+    template<typename Rhs>
+    Vector solve(Rhs const& b) const {
+        return apply(b);
+    }
+
+    Eigen::ComputationInfo info() { return Eigen::Success; }
+
+    // the preconditioner which was effectively set up by the last call of compute
+    PreconditionerType get_active() const {
+        return active;
+    }
+
+private:
+
+    void factorize_dense(Eigen::Ref<const Eigen::MatrixXd> G);
+    Vector apply(Vector const& b) const;
+
+    PreconditionerType type;
+    Mesh const* mesh;
+    FrozenLU* frozen;
+
+    PreconditionerType active;
+    Vector inv_diag;
+    Eigen::IncompleteLUT<double> ilu;
+    std::shared_ptr<const LooseParts> loose_parts;
+    std::vector<Eigen::PartialPivLU<Eigen::MatrixXd>> blocks;
+};
+
+} // namespace Bem
+
+#endif // PRECONDITIONER_HPP
@@ -5,17 +5,15 @@
 #include "../Mesh/HalfedgeMesh.hpp"
 #include "../Mesh/MeshManip.hpp"
 #include "../Mesh/MeshIO.hpp"
+#include "MatrixFreeOperator.hpp"
 #include <vector>
-#ifdef VERBOSE
 #include <chrono>
-#endif
 
 #include <Eigen/IterativeLinearSolvers> // for conjugate gradient solver
+#include <unsupported/Eigen/IterativeSolvers> // GMRES
 
 using namespace std;
-#ifdef VERBOSE
 using namespace chrono;
-#endif
 
 
 namespace Bem {
@@ -38,38 +36,171 @@ real default_field(vec3 x,real t) {
 }
 
 Eigen::VectorXd Simulation::solve_system(Eigen::MatrixXd const& G,Eigen::VectorXd const& H_phi) const {
+    return solve_dense(G,H_phi,nullptr);
+}
+
+Eigen::VectorXd Simulation::solve_system(Eigen::MatrixXd const& G,Eigen::VectorXd const& H_phi,Mesh const& m) const {
+    return solve_dense(G,H_phi,&m);
+}
+
+// runs the iterative solver (with the preconditioner already set up) and records its statistics
+template<typename solver_t,typename matrix_t>
+static Eigen::VectorXd iterative_solve(solver_t& solver,matrix_t const& G,Eigen::VectorXd const& H_phi,Eigen::VectorXd const* guess,
+                                       real tolerance,size_t max_iterations,SolveInfo& info) {
+    auto start = high_resolution_clock::now();
+    if(tolerance > 0.0)     solver.setTolerance(tolerance);
+    if(max_iterations > 0)  solver.setMaxIterations(max_iterations);
+    solver.compute(G);
+    auto setup = high_resolution_clock::now();
+
+    Eigen::VectorXd x;
+    if(guess != nullptr) x = solver.solveWithGuess(H_phi,*guess);
+    else                 x = solver.solve(H_phi);
+
+    info.setup_time += duration_cast<duration<double>>(setup-start).count();
+    info.solve_time += duration_cast<duration<double>>(high_resolution_clock::now()-setup).count();
+    info.iterations = solver.iterations();
+    info.error = solver.error();
+    info.converged = solver.info() == Eigen::Success;
+    return x;
+}
+
+// LU decomposition in single precision, the solution is refined with the residuals of the double G
+// until the relative residual is below tolerance (or doesn't decrease anymore)
+static Eigen::VectorXd mixed_lu_solve(Eigen::MatrixXd const& G,Eigen::VectorXd const& H_phi,real tolerance,size_t max_steps,SolveInfo& info) {
+    if(tolerance <= 0.0) tolerance = 1e-14;
+    if(max_steps == 0)   max_steps = 10;
+
+    auto start = high_resolution_clock::now();
+    Eigen::PartialPivLU<Eigen::MatrixXf> lu(G.cast<float>());
+    auto setup = high_resolution_clock::now();
+
+    real norm(H_phi.norm());
+    Eigen::VectorXd x = lu.solve(H_phi.cast<float>()).cast<double>();
+    Eigen::VectorXd r = H_phi - G*x;
+    info.error = r.norm()/norm;
+    info.residual = info.error; // residual of the returned x (error is the smallest one)
+    info.iterations = 0;
+    while(info.error > tolerance and info.iterations < max_steps) {
+        x += lu.solve(r.cast<float>()).cast<double>();
+        r = H_phi - G*x;
+        real error(r.norm()/norm);
+        info.residual = error;
+        info.iterations++;
+        if(error > 0.5*info.error) { // stagnation
+            info.error = min(error,info.error);
+            break;
+        }
+        info.error = error;
+    }
+    info.converged = info.error <= tolerance;
+
+    info.setup_time += duration_cast<duration<double>>(setup-start).count();
+    info.solve_time += duration_cast<duration<double>>(high_resolution_clock::now()-setup).count();
+    return x;
+}
+
+Eigen::VectorXd Simulation::solve_dense(Eigen::MatrixXd const& G,Eigen::VectorXd const& H_phi,Mesh const* m) const {
     // attention! right now, G is completely symmetric! could only use one half!
 #ifdef VERBOSE
     cout << " solving system..." << flush;
-    auto start = high_resolution_clock::now();
 #endif
+
+    SolveInfo info;
+    info.solver = solver;
+
+    // The previous solution is a good guess: successive RK stages differ only slightly, and after
+    // remeshing it is interpolated to the new vertices (see LinLinSim::remesh).
+    Eigen::VectorXd const* guess(nullptr);
+    if(warm_start and psi_guess.size() == H_phi.size()) guess = &psi_guess;
+
+    Eigen::VectorXd x;
+    if(solver == SolverType::bicgstab) {
+        Eigen::BiCGSTAB<Eigen::MatrixXd,SystemPreconditioner> it_solver;
+        it_solver.preconditioner().setup(preconditioner,m,&frozen_lu);
+        x = iterative_solve(it_solver,G,H_phi,guess,solver_tolerance,max_iterations,info);
+    } else if(solver == SolverType::gmres) {
+        Eigen::GMRES<Eigen::MatrixXd,SystemPreconditioner> it_solver;
+        it_solver.set_restart(gmres_restart);
+        it_solver.preconditioner().setup(preconditioner,m,&frozen_lu);
+        x = iterative_solve(it_solver,G,H_phi,guess,solver_tolerance,max_iterations,info);
+    } else if(solver == SolverType::mixed_lu) {
+        x = mixed_lu_solve(G,H_phi,solver_tolerance,max_iterations,info);
+    }
+
     // PartialPivLU needs an invertible SQUARE matrix! to be sure, can use FullPivLU, but not in parallel!
+    if(solver == SolverType::lu or not info.converged) {
+        info.fallback = solver != SolverType::lu;
+        auto start = high_resolution_clock::now();
+        Eigen::PartialPivLU<Eigen::MatrixXd> lu;
+        lu.compute(G);
+        auto setup = high_resolution_clock::now();
+        x = lu.solve(H_phi);
+        info.setup_time += duration_cast<duration<double>>(setup-start).count();
+        info.solve_time += duration_cast<duration<double>>(high_resolution_clock::now()-setup).count();
+    }
+    if(warm_start) psi_guess = x;
+
+    // mixed_lu has the residual of x from its refinement, otherwise it costs another product with G
+    // and is only computed if the history is recorded
+    if(solver != SolverType::mixed_lu or info.fallback)
+        info.residual = record_history ? (G*x - H_phi).norm()/H_phi.norm() : -1.0;
+    record_solve(info);
+
+#ifdef VERBOSE
+    cout << " - done." << endl;
+    cout << "used time = " << info.setup_time << " s (setup) + " << info.solve_time << " s (solve). " << endl;
+    if(solver == SolverType::mixed_lu) cout << "refinement steps: " << info.iterations << (info.fallback ? " (not converged, solved with double LU)" : "") << endl;
+    else if(solver != SolverType::lu) cout << "iterations: " << info.iterations << ", estimated error: " << info.error << (info.fallback ? " (not converged, solved with LU)" : "") << endl;
+    if(info.residual >= 0.0) cout << "relative residual: " << info.residual << endl;
+#endif
+    return x;
+}
+
+// There is no LU fallback for the matrix-free system, lu and mixed_lu select BiCGSTAB here.
+Eigen::VectorXd Simulation::solve_system(MatrixFreeOperator const& G,Eigen::VectorXd const& H_phi) const {
+#ifdef VERBOSE
+    cout << " solving system (matrix-free)..." << flush;
+#endif
+
+    SolveInfo info;
+    Eigen::VectorXd const* guess(nullptr);
+    if(warm_start and psi_guess.size() == H_phi.size()) guess = &psi_guess;
 
     Eigen::VectorXd x;
-    if(bicgstab){
-        Eigen::BiCGSTAB<Eigen::MatrixXd> solver;
-        solver.compute(G);
-        x = solver.solve(H_phi);
-        // It is possible to use a guess for solving the linear system with the BiCGSTAB method. The previous
-        // psi-vector may be a good guess, but it cannot naively used when applying remeshing - at least the 
-        // values of psi would have to be newly interpolated.
-        //Eigen::VectorXd x = solver.solveWithGuess(H_phi,psi); 
+    if(solver == SolverType::gmres) {
+        info.solver = SolverType::gmres;
+        Eigen::GMRES<MatrixFreeOperator,MatrixFreeJacobi> it_solver;
+        it_solver.set_restart(gmres_restart);
+        x = iterative_solve(it_solver,G,H_phi,guess,solver_tolerance,max_iterations,info);
     } else {
-        Eigen::PartialPivLU<Eigen::MatrixXd> solver;
-        solver.compute(G);
-        x = solver.solve(H_phi);
+        info.solver = SolverType::bicgstab;
+        Eigen::BiCGSTAB<MatrixFreeOperator,MatrixFreeJacobi> it_solver;
+        x = iterative_solve(it_solver,G,H_phi,guess,solver_tolerance,max_iterations,info);
     }
+    if(warm_start) psi_guess = x;
+
+    if(record_history) {
+        Eigen::VectorXd G_x = G*x;
+        info.residual = (G_x - H_phi).norm()/H_phi.norm();
+    } else {
+        info.residual = -1.0;
+    }
+    record_solve(info);
 
 #ifdef VERBOSE
     cout << " - done." << endl;
-    auto end = high_resolution_clock::now();
-    cout << "used time = " << duration_cast<duration<double>>(end-start).count() << " s. " << endl;
-    //cout << "estimated error: " << solver.error() << endl;
-    cout << "true error: " << (G*x - H_phi).maxCoeff() << endl;
+    cout << "used time = " << info.setup_time << " s (setup) + " << info.solve_time << " s (solve). " << endl;
+    cout << "iterations: " << info.iterations << ", estimated error: " << info.error << (info.converged ? "" : " (not converged)") << endl;
 #endif
     return x;
 }
 
+void Simulation::record_solve(SolveInfo const& info) const {
+    last_solve = info;
+    if(record_history) solve_history.push_back(info);
+}
+
 real Simulation::potential_t(real grad_squared, real volume, real kappa,vec3 pos, real t) const {
     return  2.0*sigma*kappa + 0.5*grad_squared + p_inf - epsilon*pow(V_0/volume,gamma) + pressurefield(pos,t);
 }
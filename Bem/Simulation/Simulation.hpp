@@ -8,6 +8,8 @@
 #include "../basic/Bem.hpp"
 #include "../Mesh/Mesh.hpp"
 #include "../Integration/Integrator.hpp"
+#include "Preconditioner.hpp"
+#include "Workspace.hpp"
 
 #include <Eigen/Dense>
 
@@ -15,6 +17,7 @@
 
 namespace Bem {
 
+class MatrixFreeOperator;
 
 // functions for translating between PotVec and Eigen::VectorXd
 std::vector<real> make_copy(Eigen::VectorXd const& vec);
@@ -23,6 +26,30 @@ Eigen::VectorXd make_copy(std::vector<real> const& vec);
 // default pressure field
 real default_field(vec3 x,real t);
 
+// solvers for the system G*psi = H*phi:
+// lu:       direct solution with PartialPivLU
+// mixed_lu: PartialPivLU of a float copy of G (about twice as fast, half the memory), followed by iterative
+//           refinement of the solution with the residuals of the double G
+// bicgstab: BiCGSTAB
+// gmres:    restarted GMRES(m)
+// The iterative solvers use the preconditioner set with Simulation::set_preconditioner.
+enum class SolverType { lu, mixed_lu, bicgstab, gmres };
+
+// statistics of a call of Simulation::solve_system
+struct SolveInfo {
+    SolverType solver = SolverType::lu;
+    size_t iterations = 0;  // zero for lu, refinement steps for mixed_lu
+    real error = 0.0;       // estimated relative residual of the iterative solver
+    real residual = 0.0;    // relative residual |G*psi - H_phi|/|H_phi| of the returned solution (negative
+                            // if it isn't available: it is only computed with set_record_solve_history,
+                            // except for mixed_lu, and never by ColocSim::solve_pipelined)
+    bool converged = true;
+    bool fallback = false;  // the iterative solver didn't converge and the system was solved with LU
+    real setup_time = 0.0;  // factorization resp. preconditioner setup (including the assembly of G if
+                            // both are overlapped) [s]
+    real solve_time = 0.0;  // [s]
+};
+
 class Simulation {
 public:
 
@@ -35,7 +62,13 @@ public:
         time(0.0),
         min_dt(-1.0),
         dp_balance(3.0),
-        bicgstab(true),
+        solver(SolverType::bicgstab),
+        solver_tolerance(0.0),
+        max_iterations(0),
+        gmres_restart(30),
+        warm_start(true),
+        preconditioner(PreconditionerType::diagonal),
+        record_history(false),
         num_threads(100),
         mesh(initial) {
             // initializing other default values:
@@ -68,12 +101,16 @@ public:
 
     // solving the system G*psi = H_phi = H*phi for psi (returned vector)
     Eigen::VectorXd solve_system(Eigen::MatrixXd const& G,Eigen::VectorXd const& H_phi) const;
+    // the same if the unknowns correspond to the vertices of the mesh m (needed by the near_field_ilu
+    // and block_jacobi preconditioners)
+    Eigen::VectorXd solve_system(Eigen::MatrixXd const& G,Eigen::VectorXd const& H_phi,Mesh const& m) const;
+    // the same for a matrix-free G (always solved with BiCGSTAB)
+    Eigen::VectorXd solve_system(MatrixFreeOperator const& G,Eigen::VectorXd const& H_phi) const;
 
     // This function only computes the psi values without evolving the system in time
     void compute_psi() {
-        Eigen::MatrixXd G,H;
-        assemble_matrices_prop(G,H);
-        psi = solve_system(G,H*phi);
+        assemble_matrices_prop(work.G,work.H);
+        psi = solve_system(work.G,work.H*phi);
     }
 
     // function that handels the time evolution of the system: must be defined in subclasses
@@ -151,7 +188,56 @@ public:
     }
 
     void set_bcgstab(bool value) {
-        bicgstab = value;
+        solver = value ? SolverType::bicgstab : SolverType::lu;
+    }
+
+    // tolerance: relative residual at which the iterative solvers stop (<= 0: machine precision, Eigen's
+    // default, resp. 1e-14 for mixed_lu), max_iter: maximum number of iterations (0: 2N resp. 10 refinement
+    // steps), restart: m of GMRES(m). If an iterative solver or the refinement doesn't converge, the dense
+    // system is solved with the double LU instead (see SolveInfo::fallback).
+    void set_solver(SolverType type,real tolerance = 0.0,size_t max_iter = 0,size_t restart = 30) {
+        solver = type;
+        solver_tolerance = tolerance;
+        max_iterations = max_iter;
+        gmres_restart = restart;
+    }
+
+    // if set, the iterative solvers start from the solution of the previous solve (previous RK stage or time step)
+    void set_warm_start(bool value) {
+        warm_start = value;
+        psi_guess.resize(0);
+    }
+
+    // preconditioner of the iterative solver (see Preconditioner.hpp). With frozen_lu, the decomposition
+    // is recomputed at the beginning of each time step and after frozen_stages solves.
+    void set_preconditioner(PreconditionerType type,size_t frozen_stages = 4) {
+        preconditioner = type;
+        frozen_lu = FrozenLU();
+        frozen_lu.max_uses = frozen_stages;
+    }
+
+    // iterations, residuals and timings of the last solve (a default SolveInfo before the first solve)
+    SolveInfo const& get_solve_info() const {
+        return last_solve;
+    }
+
+    // if set, the SolveInfo of every solve is kept (until clear_solve_history), otherwise only the last one
+    void set_record_solve_history(bool value) {
+        record_history = value;
+    }
+
+    // the solves since the last call of clear_solve_history (empty if the history isn't recorded)
+    std::vector<SolveInfo> const& get_solve_history() const {
+        return solve_history;
+    }
+
+    void clear_solve_history() {
+        solve_history.clear();
+    }
+
+    // releases the memory of the buffers kept between the solves (see Workspace)
+    void free_workspace() {
+        work = Workspace();
     }
 
     void set_num_threads(size_t num) {
@@ -166,12 +252,21 @@ public:
         inter.set_quadrature(quad);
     }
 
+    // distance-adaptive quadrature (see Integrator::set_quadrature(real))
+    void set_quadrature(real tolerance) {
+        inter.set_quadrature(tolerance);
+    }
+
 protected:
 
     real get_dt(real dp,std::vector<vec3> const& gradients, std::vector<real> const& grad_potential) const;
     // time derivative of the potential
     real potential_t(real grad_squared, real volume, real kappa, vec3 pos, real t) const;
 
+    Eigen::VectorXd solve_dense(Eigen::MatrixXd const& G,Eigen::VectorXd const& H_phi,Mesh const* m) const;
+    // stores the statistics of a solve (see get_solve_info, set_record_solve_history)
+    void record_solve(SolveInfo const& info) const;
+
 
     // The following constants are given in simulation units;
     // Eventual conversions happen outside this class
@@ -191,9 +286,25 @@ protected:
     real dp_balance;
 
     // which solver
-    bool bicgstab;
+    SolverType solver;
+    real solver_tolerance;
+    size_t max_iterations;
+    size_t gmres_restart;
+
+    // warm start of the iterative solver: psi_guess is the last solution of solve_system (empty if there
+    // is none or it doesn't fit the current mesh). remesh transfers it to the new vertices.
+    bool warm_start;
+    mutable Eigen::VectorXd psi_guess;
+
+    PreconditionerType preconditioner;
+    mutable FrozenLU frozen_lu;
+    mutable SolveInfo last_solve;
+    bool record_history;
+    mutable std::vector<SolveInfo> solve_history;
+
+    mutable Workspace work;
 
-    // number of threads for matrix generation (if supported)
+    // number of threads for matrix generation and the projection in remesh (if supported)
     size_t num_threads;
 
     // Mesh describing the Bubble surface and an integrator object,
@@ -0,0 +1,75 @@
+#include "TiledLU.hpp"
+#include <vector>
+
+using namespace std;
+
+namespace Bem {
+
+void TiledLU::factorize_panel(size_t k) {
+    size_t N(A.rows());
+    size_t begin(panel_begin(k)), end(panel_end(k));
+
+    for(size_t c(begin);c<end;++c) {
+        // pivot search in column c
+        Eigen::Index p;
+        A.col(c).segment(c,N-c).cwiseAbs().maxCoeff(&p);
+        piv[c] = c + p;
+        if(piv[c] != c)
+            A.block(c,begin,1,end-begin).swap(A.block(piv[c],begin,1,end-begin));
+
+        real pivot(A(c,c));
+        if(pivot != 0.0)
+            A.col(c).segment(c+1,N-c-1) /= pivot;
+
+        // rank one update of the remaining columns of the panel
+        A.block(c+1,c+1,N-c-1,end-c-1).noalias() -= A.col(c).segment(c+1,N-c-1)*A.row(c).segment(c+1,end-c-1);
+    }
+}
+
+void TiledLU::update_panel(size_t k,size_t j) {
+    size_t N(A.rows());
+    size_t begin(panel_begin(k)), end(panel_end(k));
+    size_t j_begin(panel_begin(j)), j_end(panel_end(j));
+    size_t nj(j_end-j_begin);
+
+    for(size_t c(begin);c<end;++c) {
+        if(piv[c] != c)
+            A.block(c,j_begin,1,nj).swap(A.block(piv[c],j_begin,1,nj));
+    }
+
+    // block of U: L_kk^-1 * A_kj
+    A.block(begin,j_begin,end-begin,nj) = A.block(begin,begin,end-begin,end-begin).triangularView<Eigen::UnitLower>().solve(A.block(begin,j_begin,end-begin,nj));
+    // trailing update
+    A.block(end,j_begin,N-end,nj).noalias() -= A.block(end,begin,N-end,end-begin)*A.block(begin,j_begin,end-begin,nj);
+}
+
+void TiledLU::finish() {
+    for(size_t k(1);k<num_panels();++k) {
+        size_t begin(panel_begin(k));
+        for(size_t c(begin);c<panel_end(k);++c) {
+            if(piv[c] != c)
+                A.block(c,0,1,begin).swap(A.block(piv[c],0,1,begin));
+        }
+    }
+}
+
+Eigen::VectorXd TiledLU::solve(Eigen::VectorXd const& b) const {
+    // P*A = L*U  ->  x = U^-1 * L^-1 * P*b
+    Eigen::VectorXd x(b);
+    for(size_t c(0);c<piv.size();++c)
+        std::swap(x(c),x(piv[c]));
+    x = A.triangularView<Eigen::UnitLower>().solve(x);
+    x = A.triangularView<Eigen::Upper>().solve(x);
+    return x;
+}
+
+Eigen::VectorXd TiledLU::solve_transposed(Eigen::VectorXd const& b) const {
+    // A^T = U^T * L^T * P  ->  x = P^T * L^-T * U^-T * b
+    Eigen::VectorXd x = A.transpose().triangularView<Eigen::Lower>().solve(b);
+    x = A.transpose().triangularView<Eigen::UnitUpper>().solve(x);
+    for(size_t c(piv.size());c-->0;)
+        std::swap(x(c),x(piv[c]));
+    return x;
+}
+
+} // namespace Bem
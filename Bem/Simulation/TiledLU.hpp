@@ -0,0 +1,114 @@
+#ifndef TILEDLU_HPP
+#define TILEDLU_HPP
+
+#include <vector>
+#include "../basic/Bem.hpp"
+
+#include <Eigen/Dense>
+#include <omp.h>
+
+namespace Bem {
+
+// The TiledLU computes the LU decomposition with partial pivoting P*A = L*U of a dense matrix A, which is
+// split into column panels of panel_size columns. The factorization of panel k and the updates of the
+// panels j > k by panel k are OpenMP tasks whose dependencies follow the panels, so the updates of
+// different panels run in parallel. The matrix doesn't have to be complete when the factorization
+// starts: factorize takes a function that fills a panel, and the tasks of a panel only wait for its own
+// assembly (pipelining of assembly and factorization).
+// For the colocation system it is applied to A = G^T: a column panel of A is a block of colocation rows
+// of G, which is how the colocation matrices are assembled. solve_transposed then solves G*x = b.
+class TiledLU {
+public:
+
+    TiledLU(size_t N = 0,size_t panel_size = 128)
+        :A(N,N),
+        piv(N),
+        panel_size(panel_size) {}
+
+    // changes the size of the matrix (the memory is only reallocated if N changed)
+    void resize(size_t N) {
+        A.resize(N,N);
+        piv.resize(N);
+    }
+
+    size_t num_panels() const {
+        return (A.cols() + panel_size - 1)/panel_size;
+    }
+
+    // columns of panel k
+    size_t panel_begin(size_t k) const {
+        return k*panel_size;
+    }
+    size_t panel_end(size_t k) const {
+        return std::min(size_t(A.cols()),(k+1)*panel_size);
+    }
+
+    // the matrix to factorize (overwritten by the factors)
+    Eigen::MatrixXd& matrix() {
+        return A;
+    }
+
+    // factorizes the matrix, assemble(k) has to fill the columns of panel k. It is called in an OpenMP
+    // task (from any thread of the current team) and may run concurrently with the factorization of
+    // other panels.
+    template<typename assemble_t>
+    void factorize(assemble_t const& assemble,size_t num_threads);
+
+    // factorizes the (already filled) matrix
+    void factorize(size_t num_threads) {
+        factorize([](size_t){},num_threads);
+    }
+
+    // solves A*x = b resp. A^T*x = b with the factorization
+    Eigen::VectorXd solve(Eigen::VectorXd const& b) const;
+    Eigen::VectorXd solve_transposed(Eigen::VectorXd const& b) const;
+
+private:
+
+    // unblocked LU with partial pivoting of the columns of panel k (rows panel_begin(k),...,N-1)
+    void factorize_panel(size_t k);
+    // applies the row interchanges of panel k to panel j, computes the block of U and updates
+    // the trailing part of panel j
+    void update_panel(size_t k,size_t j);
+    // applies the row interchanges of the later panels to the columns of L of the earlier ones
+    void finish();
+
+    Eigen::MatrixXd A;
+    std::vector<size_t> piv; // row piv[c] was swapped with row c in the elimination of column c
+    size_t panel_size;
+};
+
+template<typename assemble_t>
+void TiledLU::factorize(assemble_t const& assemble,size_t num_threads) {
+    size_t NP(num_panels());
+    std::vector<char> dep(NP); // dependency tokens of the panels
+
+    omp_set_num_threads(num_threads);
+
+    char* d = dep.data();
+
+    #pragma omp parallel
+    #pragma omp single
+    {
+        for(size_t j = 0;j<NP;++j) {
+            #pragma omp task depend(out: d[j]) firstprivate(j) shared(assemble)
+            assemble(j);
+        }
+
+        for(size_t k = 0;k<NP;++k) {
+            #pragma omp task depend(inout: d[k]) firstprivate(k)
+            factorize_panel(k);
+
+            for(size_t j = k+1;j<NP;++j) {
+                #pragma omp task depend(in: d[k]) depend(inout: d[j]) firstprivate(k,j)
+                update_panel(k,j);
+            }
+        }
+    }
+
+    finish();
+}
+
+} // namespace Bem
+
+#endif // TILEDLU_HPP
@@ -0,0 +1,50 @@
+#ifndef WORKSPACE_HPP
+#define WORKSPACE_HPP
+
+#include <vector>
+#include "../basic/Bem.hpp"
+#include "../Mesh/Mesh.hpp"
+#include "TiledLU.hpp"
+
+#include <Eigen/Dense>
+
+namespace Bem {
+
+// The Workspace is kept by the Simulation between the solutions of the boundary integral equation (the
+// stages of a time step and the following time steps), such that the large buffers are not allocated and
+// page faulted again for every stage:
+// G, H:    the dense system matrices (assemble_matrices only reallocates them if the number of vertices
+//          changed, i.e. after a remesh)
+// lu:      the TiledLU of the pipelined solver (ColocSim::solve_pipelined)
+// stages:  the meshes of the intermediate Runge-Kutta stages (only their vertices change)
+// G_loc, H_loc: scratch matrices of the assembly threads, see reserve_scratch
+// batch_scratch: index buffers of the assembly threads (see Integrator::integrate_Lin_coloc_batch)
+struct Workspace {
+    Eigen::MatrixXd G, H;
+    TiledLU lu;
+    std::vector<Mesh> stages;
+
+    // makes sure there is a pair of scratch matrices with 3 columns and at least N rows for each of the
+    // first num_threads threads. The scratch matrices only grow, and they are zero: the assembly resets
+    // every entry it wrote before returning.
+    void reserve_scratch(size_t num_threads,size_t N) {
+        if(G_loc.size() < num_threads) {
+            G_loc.resize(num_threads);
+            H_loc.resize(num_threads);
+            batch_scratch.resize(num_threads);
+        }
+        for(size_t t(0);t<num_threads;++t) {
+            if(size_t(G_loc[t].rows()) < N) {
+                G_loc[t] = Eigen::MatrixXd::Zero(N,3);
+                H_loc[t] = Eigen::MatrixXd::Zero(N,3);
+            }
+        }
+    }
+
+    std::vector<Eigen::MatrixXd> G_loc, H_loc;
+    std::vector<std::vector<size_t>> batch_scratch;
+};
+
+} // namespace Bem
+
+#endif // WORKSPACE_HPP
@@ -11,13 +11,23 @@ using namespace std;
 using namespace Bem;
 
 
-int main() {
+int main(int argc, char *argv[]) {
 
     // This code computes the potential u exterior of the bubble. We assume that meshes/mesh-113.ply
     // is generated with main.cpp. If changes to the parameters in main.cpp are conducted, they have
     // to be implemented in this file too (see below). The result is stored in the two files 
     // pot-ext.csv and pot_t-ext.csv (the potential and its time derivative). They can be visualized
     // using python_utils/pressure/pressure-pot-plot.py.
+    //
+    // usage: pot-ext [theta]
+    // By default, all triangle integrals are summed up directly. With an opening angle theta > 0, the
+    // potential is approximated with multipole expansions (much faster for large grids), but then only
+    // pot-ext.csv is written: the finite difference for the time derivative divides the difference of
+    // two such approximations by dt, which amplifies their errors (the expansions of the two meshes
+    // aren't the same), so pot_t-ext.csv always needs the direct sums.
+
+    Bem::real theta = 0.0;
+    if(argc > 1) theta = atof(argv[1]);
 
     Mesh M;
     vector<Bem::real> phi,psi;
@@ -60,13 +70,17 @@ int main() {
 
     vector<Bem::real> phi_ext,phi_ext_A,phi_t_ext;
 
-    // compute the potential at the positions given by x
-    phi_ext_A = compute_exterior_pot(x,simA.mesh,simA.get_phi(),simA.get_psi());
-    phi_ext   = compute_exterior_pot(x,sim.mesh,sim.get_phi(),sim.get_psi());
-    
-    // compute the time derivative of the potential using finite difference
-    for(size_t i(0);i<phi_ext_A.size();++i)
-        phi_t_ext.push_back((phi_ext_A[i] - phi_ext[i])/dt);
+    // compute the potential at the positions given by x. The last argument is the opening angle
+    // of the multipole expansions (zero: sum up all triangle integrals directly)
+    phi_ext   = compute_exterior_pot(x,sim.mesh,sim.get_phi(),sim.get_psi(),theta);
+
+    if(theta == 0.0) {
+        phi_ext_A = compute_exterior_pot(x,simA.mesh,simA.get_phi(),simA.get_psi(),0.0);
+
+        // compute the time derivative of the potential using finite difference
+        for(size_t i(0);i<phi_ext_A.size();++i)
+            phi_t_ext.push_back((phi_ext_A[i] - phi_ext[i])/dt);
+    }
 
 
     // writing the vectors to two separate files 
@@ -78,11 +92,15 @@ int main() {
     }
     output.close();
 
-    output.open("pot_t-ext.csv");
-    for(size_t i(0);i<phi_t_ext.size();++i) {
-        output << x[i].x << ';' << x[i].y << ';' << x[i].z << ';' << phi_t_ext[i] << endl;
+    if(theta == 0.0) {
+        output.open("pot_t-ext.csv");
+        for(size_t i(0);i<phi_t_ext.size();++i) {
+            output << x[i].x << ';' << x[i].y << ';' << x[i].z << ';' << phi_t_ext[i] << endl;
+        }
+        output.close();
+    } else {
+        cout << "theta > 0: pot_t-ext.csv is not written (needs theta = 0)" << endl;
     }
-    output.close();
 
     return 0;
 }